@@ -33,6 +33,19 @@
     #else
         #define ST_HAS_FAST_PEXT 0
     #endif
+
+    // avx512dq for vpmullq, avx512vl for masked compares on ymm registers
+    #if __AVX512F__ && __AVX512DQ__ && __AVX512VL__
+        #define ST_HAS_AVX512 1
+    #else
+        #define ST_HAS_AVX512 0
+    #endif
+
+    #if __AVX2__
+        #define ST_HAS_AVX2 1
+    #else
+        #define ST_HAS_AVX2 0
+    #endif
 #else
     #error no arch specified
 #endif
@@ -21,6 +21,7 @@
  */
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <fstream>
 #include <functional>
@@ -28,11 +29,33 @@
 #include <iostream>
 #include <mutex>
 #include <optional>
+#include <span>
 #include <string_view>
 #include <thread>
+#include <type_traits>
 
 #include "bitboard.h"
 #include "pext/pext.h"
+#include "search/anneal.h"
+#include "search/backtrack.h"
+#include "search/budget.h"
+#include "search/candidates.h"
+#include "search/corpus.h"
+#include "search/enumerate.h"
+#include "search/folded.h"
+#include "search/genetic.h"
+#include "search/kernel.h"
+#include "search/magic.h"
+#include "search/packing.h"
+#include "search/prefilter.h"
+#include "search/scratch.h"
+#include "search/search.h"
+#include "search/shared.h"
+#include "search/simd.h"
+#include "search/span.h"
+#include "search/trace.h"
+#include "search/square_table.h"
+#include "search/stats.h"
 #include "util/blocking_queue.h"
 #include "util/rng.h"
 
@@ -44,118 +67,863 @@ namespace {
     constexpr usize kAttempts = 10000000;
     constexpr i32 kThreads = 16;
 
-    constexpr bool kBlackMagic = true;
+    // hand out each level's kAttempts in chunks, stopping levels whose chance of
+    // success has become too small and pooling the attempts they gave up for
+    // levels still likely to succeed. only the random engine draws in chunks.
+    // levels share the pool across threads, so how many attempts a level gets, and
+    // with it the magics written, depends on thread timing
+    constexpr bool kAdaptiveBudget = false;
 
-    [[nodiscard]] usize getIdx(u128 mask, u128 occ, u128 magic, i32 shift) {
-        if constexpr (kBlackMagic) {
-            return static_cast<usize>(((occ | ~mask) * magic) >> shift);
-        } else {
-            return static_cast<usize>((occ * magic) >> shift);
+    constexpr search::BudgetParams kBudgetParams{
+        .chunk = kAttempts / 64,
+        .minSuccessProbability = 0.02,
+        .maxScale = 4.0,
+        .initialDecline = 16.0,
+    };
+
+    constexpr auto kOrder = search::OccupancyOrder::kFailFast;
+
+    // instantiate the scalar kernel for each mask size, so every walk has a
+    // compile-time trip count. rejections average only a few subsets, so this is
+    // within noise of the generic kernel and costs build time - see bench
+    constexpr bool kSpecializeMaskBits = false;
+
+    // test several candidates at once across vector lanes, in the fail-fast order.
+    // the lane count is picked from the instruction sets -march=native enables.
+    // lanes run until the last one collides, and rejection lengths have a long
+    // tail, so this is not yet faster than the scalar kernel - see bench
+    constexpr bool kSimd = false;
+
+    constexpr search::Prefilter kPrefilter{
+        .minSpread = 0,
+        .singleBlockers = true,
+    };
+
+    // let a bandit shift candidates towards whichever generation strategies
+    // are doing best for each square and bit count, instead of always kStrategy.
+    // finds more magics than and3 for lances and bishops, but fewer for rooks
+    constexpr bool kAdaptiveCandidates = false;
+    constexpr auto kStrategy = search::Strategy::kAnd3;
+
+    enum class Engine {
+        // rejection sampling of random candidates
+        kRandom,
+        // simulated annealing over bit flips, driven by collision counts
+        kAnneal,
+        // evolution of a pool of low-collision candidates, optionally seeded from known magics
+        kGenetic,
+        // depth-first search over sparse magics, fixing bits from the top down
+        kBacktrack,
+        // every magic with few set bits, proving none exists below the shift found
+        kEnumerate,
+    };
+
+    constexpr auto kEngine = Engine::kRandom;
+
+    enum class SchemeChoice {
+        // search only black or only white magics
+        kBlack,
+        kWhite,
+        // search both, and keep whichever reaches the larger shift for each
+        // square, black on ties. the output flags each square's scheme
+        kPerSquare,
+        // search both, and keep the scheme with the smaller tables in total
+        kUniform,
+    };
+
+    constexpr auto kSchemeChoice = SchemeChoice::kPerSquare;
+
+    [[nodiscard]] constexpr bool searchesScheme(search::MagicScheme scheme) {
+        switch (kSchemeChoice) {
+            case SchemeChoice::kBlack:
+                return scheme == search::MagicScheme::kBlack;
+            case SchemeChoice::kWhite:
+                return scheme == search::MagicScheme::kWhite;
+            default:
+                return true;
         }
     }
 
-    struct Magic {
-        u128 magic;
-        i32 shift;
+    constexpr u32 kSchemesSearched =
+        searchesScheme(search::MagicScheme::kBlack) + searchesScheme(search::MagicScheme::kWhite);
+
+    // restrict magics to a shape with a cheaper lookup multiply
+    constexpr auto kMagicShape = search::MagicShape::kFull;
+
+    static_assert(
+        kMagicShape == search::MagicShape::kFull || kEngine == Engine::kRandom,
+        "magic shapes are only applied to random candidates"
+    );
+
+    constexpr search::AnnealParams kAnnealParams{
+        .iterations = 1000000,
+        .runLength = 20000,
+        .startTemperature = 4.0,
+        .endTemperature = 0.1,
     };
 
-    [[nodiscard]] std::optional<u128> findMagic(Square sq, u128 mask, i32 bits, const auto& attackGetter) {
-        assert(mask != 0);
+    constexpr search::GeneticParams kGeneticParams{
+        .generations = 20000,
+        .populationSize = 64,
+        .tournamentSize = 4,
+        .mutationBits = 2,
+    };
 
-        const auto count = 1 << bits;
-        const auto shift = 128 - bits;
+    constexpr search::BacktrackParams kBacktrackParams{
+        .maxSetBits = 8,
+        .prefixBits = 4,
+        .maxNodes = 10000000,
+    };
 
-        util::rng::Jsf64Rng rng{kSeed};
+    constexpr search::EnumerateParams kEnumerateParams{
+        .maxSetBits = 4,
+        .partitions = 16,
+    };
+
+    // random candidate streams searching each square at once, each with its own
+    // seed and an even share of every level's attempts. all of a square's streams
+    // give up a level as soon as one of them finds a magic there, and a level only
+    // fails once every stream has used up its share. which stream gets there first
+    // depends on thread timing, so with more than one stream the magics written can
+    // differ from run to run. 1 keeps the output reproducible
+    constexpr u32 kRandomStreams = 1;
+
+    // have a square's random streams claim different levels at once instead of all
+    // descending together, each level getting the full kAttempts. finding a magic
+    // cancels the easier levels above it, and exhausting a level aborts those below.
+    // draws about 1.6x the candidates of the plain descent for the same tables, in
+    // exchange for a shorter wait on each square's hardest level
+    constexpr bool kSpeculativeLevels = false;
+
+    // most levels of a square searched at once when speculating. only this many of
+    // its streams are queued, as any more would have no level to claim
+    constexpr u32 kSpeculativeWidth = 2;
+
+    // each square's search is split into this many tasks, which may run on different threads
+    constexpr u32 kTasksPerSquare = [] {
+        switch (kEngine) {
+            case Engine::kRandom:
+                return kSpeculativeLevels ? std::min(kRandomStreams, kSpeculativeWidth) : kRandomStreams;
+            case Engine::kBacktrack:
+                return 1U << kBacktrackParams.prefixBits;
+            case Engine::kEnumerate:
+                return kEnumerateParams.partitions;
+            default:
+                return 1U;
+        }
+    }();
+
+    // attempts each task spends on a level
+    constexpr usize kTaskAttempts = kSpeculativeLevels ? kAttempts : kAttempts / kTasksPerSquare;
+
+    // file holding k<Piece>Magics arrays to seed the genetic engine from,
+    // e.g. a previous run's output or stoat's own tables. empty to seed nothing
+    constexpr std::string_view kCorpusPath = "";
+
+    // give every square of a piece the same shift, so lookups need no per-square
+    // shift and can gather across squares. the shift is the smallest any square
+    // reached, which every square's magic is also valid at
+    constexpr bool kFixedShift = false;
 
-        std::vector<Bitboard> used{};
-        used.resize(count);
+    // random candidates tried at a square's best shift once the descent ends, keeping
+    // the valid magic with the smallest table. 0 keeps the first magic found
+    constexpr usize kSpanAttempts = 1000000;
+    constexpr u64 kSpanSeed = kSeed + 1;
+    constexpr auto kSpanObjective = search::SpanObjective::kMaxIndex;
 
-        for (usize i = 0; i < kAttempts; ++i) {
-            bool failed = false;
-            std::memset(used.data(), 0, used.size() * sizeof(Bitboard));
+    // directory holding <Piece>_trace.txt occupancy traces, see loadOccupancyTrace.
+    // squares with traced lookups minimize the cache lines or pages serving
+    // kTraceCoverage of them instead, kSpanObjective only breaking ties. empty to
+    // read no traces
+    constexpr std::string_view kTraceDir = "";
+    constexpr auto kTraceObjective = search::TraceObjective::kCacheLines;
+    constexpr f64 kTraceCoverage = 0.99;
 
-            const auto candidate = rng.nextU128() & rng.nextU128() & rng.nextU128();
+    // shared mode: candidates per round, split across the threads, each round
+    // keeping the candidate valid for the most unserved squares
+    constexpr usize kSharedAttempts = 1000000;
+    constexpr usize kSharedMaxMagics = 64;
+    // shared magics index tables this many bits larger than the mask
+    constexpr i32 kSharedExtraBits = 0;
+    constexpr auto kSharedScheme = search::MagicScheme::kBlack;
 
-            u128 occ = 0;
-            while (true) {
-                const auto idx = getIdx(mask, occ, candidate, shift);
-                const Bitboard attacks = attackGetter(sq, Bitboard{occ});
+    constexpr usize kBenchCandidates = 100000;
+    constexpr usize kBenchAnnealIterations = 10000;
+    constexpr usize kBenchGenerations = 150;
 
-                assert(!attacks.empty());
+    // nextChunk returns how many more candidates to draw, or 0 to stop
+    void searchRandomChunked(
+        const search::SquareTable& table,
+        i32 bits,
+        u64 seed,
+        search::Scratch& scratch,
+        search::Stats& stats,
+        auto&& nextChunk,
+        auto&& onValid
+    ) {
+        bool stopped = false;
+
+        const auto onChunkValid = [&](u128 magic) {
+            stopped = onValid(magic);
+            return stopped;
+        };
+
+        const auto searchChunk = [&](auto& source, usize attempts) {
+            if constexpr (kSimd) {
+                search::searchSimd(table, bits, attempts, kPrefilter, scratch, stats, source, onChunkValid);
+            } else if constexpr (kSpecializeMaskBits) {
+                search::withClassType(table, [&]<typename Class>(Class) {
+                    search::withMaskBits(table, [&]<i32 kMaskBits>(std::integral_constant<i32, kMaskBits>) {
+                        search::searchScalar<kOrder, Class, usize{1} << kMaskBits>(
+                            table,
+                            bits,
+                            attempts,
+                            kPrefilter,
+                            scratch,
+                            stats,
+                            source,
+                            onChunkValid
+                        );
+                    });
+                });
+            } else {
+                search::withClassType(table, [&]<typename Class>(Class) {
+                    search::searchScalar<kOrder, Class>(
+                        table,
+                        bits,
+                        attempts,
+                        kPrefilter,
+                        scratch,
+                        stats,
+                        source,
+                        onChunkValid
+                    );
+                });
+            }
+        };
+
+        const auto search = [&](auto& source) {
+            scratch.order.reset(table);
 
-                if (used[idx].empty()) {
-                    used[idx] = attacks;
-                } else if (used[idx] != attacks) {
-                    failed = true;
+            while (!stopped) {
+                const usize attempts = nextChunk();
+
+                if (attempts == 0) {
                     break;
                 }
 
-                occ = (occ - mask) & mask;
-                if (occ == 0) {
-                    break;
+                searchChunk(source, attempts);
+            }
+        };
+
+        if constexpr (kAdaptiveCandidates) {
+            search::BanditSource source{seed};
+            search::ShapedSource shaped{source, search::shapeMask(kMagicShape)};
+            search(shaped);
+        } else {
+            search::FixedSource source{seed, kStrategy};
+            search::ShapedSource shaped{source, search::shapeMask(kMagicShape)};
+            search(shaped);
+        }
+    }
+
+    void searchRandom(
+        const search::SquareTable& table,
+        i32 bits,
+        usize attempts,
+        u64 seed,
+        search::Scratch& scratch,
+        search::Stats& stats,
+        auto&& onValid
+    ) {
+        auto nextChunk = [&, drawn = false]() mutable {
+            return std::exchange(drawn, true) ? 0 : attempts;
+        };
+
+        searchRandomChunked(table, bits, seed, scratch, stats, nextChunk, onValid);
+    }
+
+    // shared by every task searching one square with one scheme
+    struct SquareProgress {
+        // fewest bits a magic has been found at. the magic is valid at every level above
+        std::atomic<i32> solvedBits{std::numeric_limits<i32>::max()};
+        // most bits a level has been searched in full at without finding a magic.
+        // the levels below it are abandoned, as they are even less likely to succeed
+        std::atomic<i32> failedBits{0};
+        // the next level to claim when speculating
+        std::atomic<i32> nextBits{0};
+        // random streams that have used up their share of each level
+        std::array<std::atomic<u32>, search::kMaxMaskBits + 1> streamFailures{};
+
+        // whether another task's result already settles a level
+        [[nodiscard]] bool settled(i32 bits) const {
+            return solvedBits.load(std::memory_order::relaxed) <= bits
+                || failedBits.load(std::memory_order::relaxed) >= bits;
+        }
+
+        // counts one of `streams` streams failing a level, returning whether that was the last of them
+        [[nodiscard]] bool streamFailed(i32 bits, u32 streams) {
+            return streamFailures[bits].fetch_add(1, std::memory_order::relaxed) + 1 == streams;
+        }
+
+        void fail(i32 bits) {
+            auto failed = failedBits.load(std::memory_order::relaxed);
+            while (bits > failed && !failedBits.compare_exchange_weak(failed, bits, std::memory_order::relaxed)) {}
+        }
+
+        void solve(i32 bits) {
+            auto solved = solvedBits.load(std::memory_order::relaxed);
+            while (bits < solved && !solvedBits.compare_exchange_weak(solved, bits, std::memory_order::relaxed)) {}
+        }
+
+        // claims the next level when speculating, so that at most kSpeculativeWidth levels
+        // below the highest one not yet settled are searched at once. returns 0 if they are
+        // all claimed, leaving the square to the tasks searching it
+        [[nodiscard]] i32 claim(i32 maskBits) {
+            auto next = nextBits.load(std::memory_order::relaxed);
+
+            do {
+                const auto unsettled = std::min(solvedBits.load(std::memory_order::relaxed) - 1, maskBits);
+
+                if (next <= unsettled - static_cast<i32>(kSpeculativeWidth)) {
+                    return 0;
+                }
+            } while (!nextBits.compare_exchange_weak(next, next - 1, std::memory_order::relaxed));
+
+            return next;
+        }
+    };
+
+    // stream 0 draws from kSeed itself, the others from splitmix64 seeds derived from it
+    [[nodiscard]] u64 streamSeed(u64 stream) {
+        util::rng::SeedGenerator generator{kSeed};
+
+        u64 seed = kSeed;
+
+        for (u64 i = 0; i < stream; ++i) {
+            seed = generator.nextSeed();
+        }
+
+        return seed;
+    }
+
+    // stream picks the candidate sequence, stream 0 being kSeed's. gives up once
+    // another task searching the square settles the level
+    [[nodiscard]] std::optional<u128> findMagicRandom(
+        const search::SquareTable& table,
+        i32 bits,
+        u64 stream,
+        const SquareProgress& progress,
+        search::LevelBudget& budget,
+        search::Scratch& scratch,
+        search::Stats& stats
+    ) {
+        assert(table.mask != 0);
+
+        std::optional<u128> result{};
+
+        const auto onValid = [&](u128 magic) {
+            result = magic;
+            return true;
+        };
+
+        // polled between chunks, so a cancelled stream stops within one chunk
+        const auto cancelled = [&] { return progress.settled(bits); };
+
+        const auto seed = streamSeed(stream);
+
+        if constexpr (kAdaptiveBudget) {
+            const auto nextChunk = [&] { return cancelled() ? 0 : budget.next(stats); };
+            searchRandomChunked(table, bits, seed, scratch, stats, nextChunk, onValid);
+        } else {
+            auto nextChunk = [&, remaining = budget.attempts()]() mutable {
+                if (cancelled()) {
+                    return usize{0};
                 }
+
+                const auto chunk = std::min(remaining, kBudgetParams.chunk);
+                remaining -= chunk;
+
+                return chunk;
+            };
+
+            searchRandomChunked(table, bits, seed, scratch, stats, nextChunk, onValid);
+        }
+
+        return result;
+    }
+
+    // keeps looking for magics at the same shift, returning the one that uses the least of its
+    // table, or that serves the traced lookups from the fewest cache lines or pages
+    [[nodiscard]] u128 minimizeSpan(
+        const search::SquareTable& table,
+        i32 bits,
+        u128 magic,
+        std::span<const u32> traceWeights,
+        search::Scratch& scratch,
+        search::Stats& stats
+    ) {
+        const auto shift = 128 - bits;
+
+        const auto tracedCost = [&](u128 candidate) -> usize {
+            if (traceWeights.empty()) {
+                return 0;
             }
 
-            if (!failed) {
-                return candidate;
+            const auto span = search::tracedSpan(table, traceWeights, candidate, shift, kTraceCoverage);
+            return search::tracedCost(kTraceObjective, span);
+        };
+
+        auto best = search::tableSpan(table, magic, shift);
+        auto bestCost = tracedCost(magic);
+
+        searchRandom(table, bits, kSpanAttempts, kSpanSeed, scratch, stats, [&](u128 candidate) {
+            const auto span = search::tableSpan(table, candidate, shift);
+            const auto cost = tracedCost(candidate);
+
+            if (cost < bestCost || (cost == bestCost && search::smallerSpan(kSpanObjective, span, best))) {
+                magic = candidate;
+                best = span;
+                bestCost = cost;
             }
-        }
 
-        return {};
+            return false;
+        });
+
+        return magic;
+    }
+
+    [[nodiscard]] std::optional<u128> findMagicAnneal(
+        const search::SquareTable& table,
+        i32 bits,
+        const search::AnnealParams& params,
+        search::Scratch& scratch,
+        search::Stats& stats
+    ) {
+        util::rng::Jsf64Rng rng{kSeed};
+
+        return search::withClassType(table, [&]<typename Class>(Class) {
+            return search::anneal<Class>(table, bits, params, scratch, stats, rng);
+        });
     }
 
-    std::optional<Magic> findOptimalMagic(Square sq, Bitboard mask, const auto& attackGetter) {
-        assert(!mask.empty());
+    [[nodiscard]] std::optional<u128> findMagicGenetic(
+        const search::SquareTable& table,
+        i32 bits,
+        const search::GeneticParams& params,
+        std::span<const u128> seeds,
+        search::Scratch& scratch,
+        search::Stats& stats
+    ) {
+        util::rng::Jsf64Rng rng{kSeed};
 
-        std::optional<Magic> best{};
+        return search::withClassType(table, [&]<typename Class>(Class) {
+            return search::evolve<Class>(table, bits, params, seeds, scratch, stats, rng);
+        });
+    }
 
-        for (i32 bits = mask.popcount(); bits > 0; --bits) {
-            if (const auto magic = findMagic(sq, mask.raw(), bits, attackGetter)) {
-                best = Magic{
-                    .magic = *magic,
-                    .shift = 128 - bits,
-                };
+    [[nodiscard]] std::optional<u128> findMagicBacktrack(
+        const search::SquareTable& table,
+        i32 bits,
+        const search::BacktrackParams& params,
+        u128 prefix,
+        search::Scratch& scratch,
+        search::Stats& stats
+    ) {
+        return search::withClassType(table, [&]<typename Class>(Class) {
+            return search::backtrack<kOrder, Class>(table, bits, params, prefix, scratch, stats);
+        });
+    }
+
+    [[nodiscard]] std::optional<u128> findMagicEnumerate(
+        const search::SquareTable& table,
+        i32 bits,
+        const search::EnumerateParams& params,
+        u32 partition,
+        search::Scratch& scratch,
+        search::Stats& stats
+    ) {
+        // only the necessary part of the prefilter, or the enumeration would prove nothing
+        const search::Prefilter prefilter{.singleBlockers = kPrefilter.singleBlockers};
+
+        return search::withClassType(table, [&]<typename Class>(Class) {
+            return search::enumerate<kOrder, Class>(table, bits, params, partition, prefilter, scratch, stats);
+        });
+    }
+
+    // prefix selects the task's share of the search for engines that split it
+    [[nodiscard]] std::optional<u128> findMagic(
+        const search::SquareTable& table,
+        i32 bits,
+        u128 prefix,
+        std::span<const u128> seeds,
+        const SquareProgress& progress,
+        search::LevelBudget& budget,
+        search::Scratch& scratch,
+        search::Stats& stats
+    ) {
+        switch (kEngine) {
+            case Engine::kRandom:
+                return findMagicRandom(table, bits, static_cast<u64>(prefix), progress, budget, scratch, stats);
+            case Engine::kAnneal:
+                return findMagicAnneal(table, bits, kAnnealParams, scratch, stats);
+            case Engine::kGenetic:
+                return findMagicGenetic(table, bits, kGeneticParams, seeds, scratch, stats);
+            case Engine::kBacktrack:
+                return findMagicBacktrack(table, bits, kBacktrackParams, prefix, scratch, stats);
+            case Engine::kEnumerate:
+                return findMagicEnumerate(table, bits, kEnumerateParams, static_cast<u32>(prefix), scratch, stats);
+            default:
+                assert(false);
+                return {};
+        }
+    }
+
+    // descends from maxBits until a level fails, or the square's lower bound is reached.
+    // when speculating, claims levels from progress.nextBits instead. levels another
+    // task for this square has already solved are skipped. the magic is left untrimmed,
+    // findMagics trims the square's best once all of its tasks have finished
+    std::optional<search::Magic> findOptimalMagic(
+        const search::SquareTable& table,
+        i32 maxBits,
+        u128 prefix,
+        std::span<const u128> seeds,
+        SquareProgress& progress,
+        search::AttemptPool& pool,
+        search::LevelStats& levels,
+        search::Scratch& scratch,
+        search::Stats& stats
+    ) {
+        std::optional<search::Magic> best{};
+
+        search::LevelHistory history{};
+
+        const auto nextLevel = [&](i32 bits) {
+            if constexpr (kSpeculativeLevels) {
+                return progress.claim(table.maskBits);
             } else {
+                return bits - 1;
+            }
+        };
+
+        for (i32 bits = nextLevel(maxBits + 1); bits >= table.minBits(); bits = nextLevel(bits)) {
+            // a magic here would also be valid at the failed level
+            if (progress.failedBits.load(std::memory_order::relaxed) >= bits) {
+                break;
+            }
+
+            if (progress.solvedBits.load(std::memory_order::relaxed) <= bits) {
+                continue;
+            }
+
+            search::LevelBudget budget{
+                pool,
+                levels,
+                kBudgetParams,
+                table.maskBits - bits,
+                kTaskAttempts,
+                history.predictedRate(kBudgetParams),
+            };
+
+            const auto candidates = stats.candidates;
+            const auto magic = findMagic(table, bits, prefix, seeds, progress, budget, scratch, stats);
+
+            const auto spent = stats.candidates - candidates;
+
+            // only random streams share levels, the other engines' tasks search disjoint
+            // parts of the magics and a part failing a level fails every level below it
+            const bool cancelled = kEngine == Engine::kRandom && !magic && progress.settled(bits);
+
+            budget.finish(spent, magic.has_value(), cancelled);
+
+            if (cancelled) {
+                continue;
+            }
+
+            if (!magic) {
+                // a stream's share of a level failing says nothing about the other streams'
+                // shares, so it moves on to its share of the level below until they have all
+                // failed. a speculative task searches the whole level
+                if constexpr (kEngine == Engine::kRandom) {
+                    if (!progress.streamFailed(bits, kSpeculativeLevels ? 1 : kTasksPerSquare)) {
+                        // the level's rate is at most this, and the one below rarer still
+                        history.record(spent);
+                        continue;
+                    }
+
+                    progress.fail(bits);
+                }
+
                 break;
             }
+
+            history.record(spent);
+
+            best = search::Magic{
+                .magic = *magic,
+                .shift = 128 - bits,
+                .scheme = table.scheme,
+            };
+
+            progress.solve(bits);
         }
 
         return best;
     }
 
-    void findMagics(
+    // attacks are only ever looked up here, the search threads just read the tables
+    [[nodiscard]] std::vector<search::SquareTable> buildSquareTables(
+        const attacks::pext::internal::PieceData& data,
+        const auto& attackGetter,
+        Bitboard allowed
+    ) {
+        std::vector<search::SquareTable> tables{};
+        tables.resize(Squares::kCount);
+
+        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+            const auto sq = Square::fromRaw(sqIdx);
+
+            if (!allowed.getSquare(sq)) {
+                continue;
+            }
+
+            tables[sq.idx()] = search::buildSquareTable(sq, data.squares[sq.idx()].mask, attackGetter);
+        }
+
+        return tables;
+    }
+
+    // "black" or "white" if every square uses that scheme, otherwise "mixed"
+    [[nodiscard]] std::string_view schemeTag(std::span<const search::Magic> magics) {
+        bool black = false;
+        bool white = false;
+
+        for (const auto& magic : magics) {
+            if (magic.magic == 0) {
+                continue;
+            }
+
+            (magic.scheme == search::MagicScheme::kBlack ? black : white) = true;
+        }
+
+        return black && white ? "mixed" : white ? "white" : "black";
+    }
+
+    // writes k<piece><name> as an array of value(sq) for every square, nine to a line
+    void writeSquares(std::ostream& stream, std::string_view piece, std::string_view name, const auto& value) {
+        stream << "constexpr std::array k" << piece << name << " = {";
+
+        for (i32 rank = 0; rank < 9; ++rank) {
+            stream << "\n   ";
+            for (i32 file = 0; file < 9; ++file) {
+                const auto sq = Square::fromFileRank(file, rank);
+                stream << ' ' << value(sq) << ',';
+            }
+        }
+
+        stream << "\n};\n\n";
+    }
+
+    // only called when kEngine is kEnumerate
+    [[maybe_unused]] void writeCertificates(
+        std::string_view piece,
+        search::MagicScheme scheme,
+        const std::array<i32, Squares::kCount>& certifiedShifts
+    ) {
+        std::ofstream stream{
+            std::string{piece} + "_" + std::string{search::schemeName(scheme)} + "_certificates.txt",
+            std::ios::binary
+        };
+
+        stream << "# no magic with at most " << kEnumerateParams.maxSetBits << " set bits exists at these shifts, "
+               << search::sparseMagicCount(kEnumerateParams.maxSetBits) << " candidates tried per square\n";
+
+        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+            const auto sq = Square::fromRaw(sqIdx);
+
+            if (certifiedShifts[sq.idx()] != 0) {
+                stream << sq << ' ' << certifiedShifts[sq.idx()] << '\n';
+            }
+        }
+
+        std::cout << "wrote out " << piece << " certificates" << std::endl;
+    }
+
+    struct PieceMagics {
+        std::string_view piece;
+        Bitboard allowed;
+        std::vector<search::SquareTable> tables;
+        std::array<search::Magic, Squares::kCount> magics;
+    };
+
+    // returns nothing if any square failed
+    std::optional<PieceMagics> findMagics(
         std::string_view piece,
         const attacks::pext::internal::PieceData& data,
         const auto& attackGetter,
+        search::AttemptPool& pool,
         Bitboard allowed = Bitboards::kAll
     ) {
-        std::array<Magic, Squares::kCount> magics{};
+        struct Task {
+            Square sq;
+            search::MagicScheme scheme;
+            u128 prefix;
+        };
+
+        // best magic of each scheme, and the one chosen for output
+        std::array<std::array<search::Magic, Squares::kCount>, search::kSchemeCount> schemeMagics{};
+        std::array<search::Magic, Squares::kCount> magics{};
+
+        std::array<u32, Squares::kCount> tasksLeft{};
+        // the shift at which each square was shown to have no sparse magic, if any
+        std::array<std::array<i32, Squares::kCount>, search::kSchemeCount> certifiedShifts{};
         std::mutex magicMutex{};
 
-        util::BlockingQueue<Square> queue{};
+        // success rates by level over the squares done so far with each scheme, for adaptive budgets.
+        // the schemes' keys differ, and so do their success rates at a level
+        std::array<search::LevelStats, search::kSchemeCount> levelStats{};
+
+        std::array<std::array<SquareProgress, Squares::kCount>, search::kSchemeCount> progress{};
+
+        search::Stats pieceStats{};
+
+        auto tables = buildSquareTables(data, attackGetter, allowed);
+
+        std::vector<search::CorpusMagic> corpus{};
+
+        if (kEngine == Engine::kGenetic && !kCorpusPath.empty()) {
+            corpus = search::loadMagicCorpus(kCorpusPath, piece);
+        }
+
+        search::TraceWeights trace{};
+
+        if (!kTraceDir.empty()) {
+            trace = search::loadOccupancyTrace(
+                std::string{kTraceDir} + "/" + std::string{piece} + "_trace.txt",
+                tables
+            );
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        util::BlockingQueue<Task> queue{};
 
         std::vector<std::thread> threads{};
         threads.reserve(kThreads);
 
         for (i32 i = 0; i < kThreads; ++i) {
             threads.emplace_back([&] {
+                search::Scratch scratch{};
+                search::Stats stats{};
+
                 while (true) {
-                    const auto sq = queue.wait();
+                    const auto [sq, scheme, prefix] = queue.wait();
 
                     if (!sq) {
+                        const std::scoped_lock lock{magicMutex};
+                        pieceStats.merge(stats);
                         break;
                     }
 
-                    const auto& sqData = data.squares[sq.idx()];
+                    // a magic only means something to searches of the scheme it was found for
+                    const auto seeds = corpus.empty() || corpus[sq.idx()].scheme != scheme
+                                         ? std::span<const u128>{}
+                                         : std::span<const u128>{&corpus[sq.idx()].magic, 1};
+
+                    const auto table = search::withScheme(tables[sq.idx()], scheme);
+                    const auto schemeIdx = static_cast<usize>(scheme);
 
-                    if (const auto magic = findOptimalMagic(sq, sqData.mask, attackGetter)) {
+                    // only look for magics smaller than another task for this square already found
+                    i32 maxBits = table.maskBits;
+
+                    {
                         const std::scoped_lock lock{magicMutex};
-                        std::cout << "found " << piece << " magic for " << sq << " with shift " << magic->shift
-                                  << std::endl;
-                        magics[sq.idx()] = *magic;
-                    } else {
+
+                        if (schemeMagics[schemeIdx][sq.idx()].magic != 0) {
+                            maxBits = 128 - schemeMagics[schemeIdx][sq.idx()].shift - 1;
+                        }
+                    }
+
+                    const auto magic = findOptimalMagic(
+                        table,
+                        maxBits,
+                        prefix,
+                        seeds,
+                        progress[schemeIdx][sq.idx()],
+                        pool,
+                        levelStats[schemeIdx],
+                        scratch,
+                        stats
+                    );
+
+                    std::array<search::Magic, search::kSchemeCount> squareMagics{};
+
+                    {
                         const std::scoped_lock lock{magicMutex};
-                        std::cerr << "failed to find " << piece << " magic for square " << sq << std::endl;
+
+                        auto& best = schemeMagics[schemeIdx][sq.idx()];
+
+                        if (magic && (best.magic == 0 || magic->shift > best.shift)) {
+                            best = *magic;
+                        }
+
+                        if (--tasksLeft[sq.idx()] > 0) {
+                            continue;
+                        }
+
+                        for (usize i = 0; i < search::kSchemeCount; ++i) {
+                            squareMagics[i] = schemeMagics[i][sq.idx()];
+                        }
+                    }
+
+                    // every task for the square has finished, so the last one trims its best magics, once each
+                    for (auto& squareMagic : squareMagics) {
+                        if (squareMagic.magic == 0 || kSpanAttempts == 0) {
+                            continue;
+                        }
+
+                        squareMagic.magic = minimizeSpan(
+                            search::withScheme(tables[sq.idx()], squareMagic.scheme),
+                            128 - squareMagic.shift,
+                            squareMagic.magic,
+                            trace[sq.idx()],
+                            scratch,
+                            stats
+                        );
+                    }
+
+                    const std::scoped_lock lock{magicMutex};
+
+                    for (usize i = 0; i < search::kSchemeCount; ++i) {
+                        const auto currScheme = static_cast<search::MagicScheme>(i);
+
+                        if (!searchesScheme(currScheme)) {
+                            continue;
+                        }
+
+                        const auto& schemeBest = squareMagics[i];
+                        schemeMagics[i][sq.idx()] = schemeBest;
+                        const auto name = search::schemeName(currScheme);
+
+                        if (schemeBest.magic != 0) {
+                            std::cout << "found " << piece << " " << name << " magic for " << sq << " with shift "
+                                      << schemeBest.shift << ", " << 128 - schemeBest.shift - table.minBits()
+                                      << " bits above the lower bound" << std::endl;
+                        } else {
+                            std::cerr << "failed to find " << piece << " " << name << " magic for square " << sq
+                                      << std::endl;
+                        }
+
+                        // every partition has failed at or below the level under the best found,
+                        // and failing at a level implies failing at every level below it
+                        if (kEngine == Engine::kEnumerate && schemeBest.shift < 127) {
+                            certifiedShifts[i][sq.idx()] =
+                                schemeBest.magic != 0 ? schemeBest.shift + 1 : 128 - table.maskBits;
+
+                            std::cout << "no " << piece << " " << name << " magic for " << sq << " with at most "
+                                      << kEnumerateParams.maxSetBits << " set bits at shift "
+                                      << certifiedShifts[i][sq.idx()] << std::endl;
+                        }
                     }
                 }
             });
@@ -168,43 +936,324 @@ namespace {
                 continue;
             }
 
-            queue.push(sq);
+            tasksLeft[sq.idx()] = kTasksPerSquare * kSchemesSearched;
+
+            for (const auto scheme : {search::MagicScheme::kBlack, search::MagicScheme::kWhite}) {
+                if (!searchesScheme(scheme)) {
+                    continue;
+                }
+
+                progress[static_cast<usize>(scheme)][sq.idx()].nextBits.store(
+                    tables[sq.idx()].maskBits,
+                    std::memory_order::relaxed
+                );
+
+                for (u32 prefix = 0; prefix < kTasksPerSquare; ++prefix) {
+                    queue.push({sq, scheme, prefix});
+                }
+            }
         }
 
         for (i32 i = 0; i < kThreads; ++i) {
-            queue.push(Squares::kNone);
+            queue.push({Squares::kNone, {}, 0});
         }
 
         for (auto& thread : threads) {
             thread.join();
         }
 
-        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
-            const auto sq = Square::fromRaw(sqIdx);
-            if (magics[sq.idx()].magic == 0 && allowed.getSquare(sq)) {
-                return;
-            }
+        const auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << piece << ": " << pieceStats.candidates << " candidates, " << std::fixed << std::setprecision(2)
+                  << pieceStats.prefilterRate() * 100.0 << "% prefiltered, " << pieceStats.subsetsPerRejection()
+                  << " subsets per rejected candidate" << std::defaultfloat << std::endl;
+
+        if constexpr (kAdaptiveBudget) {
+            std::cout << piece << " budget: " << pieceStats.budgetStops << " levels stopped early, "
+                      << pieceStats.budgetBorrowed << " attempts borrowed, " << pool.credit()
+                      << " attempts left in the pool" << std::endl;
         }
 
-        std::ofstream stream{std::string{piece} + (kBlackMagic ? "_black" : "_white") + "_magic.txt", std::ios::binary};
+        if constexpr (kEngine == Engine::kAnneal) {
+            std::cout << piece << ": " << pieceStats.annealRuns << " anneal runs" << std::endl;
+        } else if constexpr (kEngine == Engine::kBacktrack) {
+            std::cout << piece << ": " << pieceStats.backtrackNodes << " nodes, " << pieceStats.backtrackPrunes
+                      << " pruned, " << pieceStats.backtrackExhausted << " searches shown to hold no magic"
+                      << std::endl;
+        } else if constexpr (kEngine == Engine::kGenetic) {
+            std::cout << piece << ": " << pieceStats.generations << " generations, " << std::fixed
+                      << std::setprecision(0) << static_cast<f64>(pieceStats.generations) / seconds
+                      << " generations/s" << std::defaultfloat << std::endl;
+        } else if constexpr (kEngine == Engine::kRandom) {
+            std::cout << piece << " strategies:";
 
-        stream << "constexpr std::array k" << piece << "Shifts = {";
+            for (usize i = 0; i < search::kStrategyCount; ++i) {
+                const auto share =
+                    static_cast<f64>(pieceStats.strategyCandidates[i]) / static_cast<f64>(pieceStats.candidates);
 
-        for (i32 rank = 0; rank < 9; ++rank) {
-            stream << "\n   ";
-            for (i32 file = 0; file < 9; ++file) {
-                const auto sq = Square::fromFileRank(file, rank);
-                stream << ' ' << magics[sq.idx()].shift << ',';
+                std::cout << ' ' << search::strategyName(static_cast<search::Strategy>(i)) << ' ' << std::fixed
+                          << std::setprecision(1) << share * 100.0 << "% (" << pieceStats.strategyHits[i]
+                          << " found)" << std::defaultfloat;
             }
+
+            std::cout << std::endl;
         }
 
-        stream << "\n};\n\n";
+        if constexpr (kEngine == Engine::kEnumerate) {
+            for (const auto scheme : {search::MagicScheme::kBlack, search::MagicScheme::kWhite}) {
+                if (searchesScheme(scheme)) {
+                    writeCertificates(piece, scheme, certifiedShifts[static_cast<usize>(scheme)]);
+                }
+            }
+        }
 
-        stream << std::hex;
-        stream << "constexpr std::array k" << piece << "Magics = {";
+        struct TableBytes {
+            usize bytes{};
+            usize unsolved{};
 
-        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
-            const auto sq = Square::fromRaw(sqIdx);
+            [[nodiscard]] bool operator<(const TableBytes& other) const {
+                return std::pair{unsolved, bytes} < std::pair{other.unsolved, other.bytes};
+            }
+        };
+
+        // full-size table bytes over the solved squares
+        const auto tableBytes = [&](const std::array<search::Magic, Squares::kCount>& pieceMagics) {
+            TableBytes result{};
+
+            for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+                const auto sq = Square::fromRaw(sqIdx);
+
+                if (!allowed.getSquare(sq)) {
+                    continue;
+                }
+
+                const auto& magic = pieceMagics[sq.idx()];
+
+                if (magic.magic == 0) {
+                    ++result.unsolved;
+                } else {
+                    result.bytes += (usize{1} << (128 - magic.shift)) * sizeof(Bitboard);
+                }
+            }
+
+            return result;
+        };
+
+        const auto& blackMagics = schemeMagics[static_cast<usize>(search::MagicScheme::kBlack)];
+        const auto& whiteMagics = schemeMagics[static_cast<usize>(search::MagicScheme::kWhite)];
+
+        switch (kSchemeChoice) {
+            case SchemeChoice::kBlack:
+                magics = blackMagics;
+                break;
+            case SchemeChoice::kWhite:
+                magics = whiteMagics;
+                break;
+            case SchemeChoice::kPerSquare:
+                for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+                    const auto& black = blackMagics[sqIdx];
+                    const auto& white = whiteMagics[sqIdx];
+
+                    const bool useWhite = white.magic != 0 && (black.magic == 0 || white.shift > black.shift);
+                    magics[sqIdx] = useWhite ? white : black;
+                }
+                break;
+            case SchemeChoice::kUniform:
+                magics = tableBytes(whiteMagics) < tableBytes(blackMagics) ? whiteMagics : blackMagics;
+                break;
+        }
+
+        const auto printBytes = [&](std::string_view name, const TableBytes& bytes) {
+            std::cout << ' ' << name << ' ' << bytes.bytes << " bytes";
+
+            if (bytes.unsolved > 0) {
+                std::cout << " (" << bytes.unsolved << " unsolved)";
+            }
+        };
+
+        std::cout << piece << " tables:";
+
+        for (usize i = 0; i < search::kSchemeCount; ++i) {
+            const auto scheme = static_cast<search::MagicScheme>(i);
+
+            if (searchesScheme(scheme)) {
+                printBytes(search::schemeName(scheme), tableBytes(schemeMagics[i]));
+                std::cout << ',';
+            }
+        }
+
+        printBytes("chosen", tableBytes(magics));
+        std::cout << std::endl;
+
+        {
+            usize atBound{};
+            usize solved{};
+            i32 totalGap{};
+            i32 maxGap{};
+
+            for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+                const auto& magic = magics[sqIdx];
+
+                if (magic.magic == 0) {
+                    continue;
+                }
+
+                const auto gap = 128 - magic.shift - tables[sqIdx].minBits();
+
+                ++solved;
+                atBound += gap == 0;
+                totalGap += gap;
+                maxGap = std::max(maxGap, gap);
+            }
+
+            std::cout << piece << " lower bound: " << atBound << " of " << solved << " squares at the bound, "
+                      << totalGap << " bits above it in total, " << maxGap << " at most" << std::endl;
+        }
+
+        if (std::ranges::any_of(trace, [](const auto& weights) { return !weights.empty(); })) {
+            search::TracedSpan total{};
+
+            for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+                const auto& magic = magics[sqIdx];
+
+                if (magic.magic == 0 || trace[sqIdx].empty()) {
+                    continue;
+                }
+
+                const auto table = search::withScheme(tables[sqIdx], magic.scheme);
+                const auto span = search::tracedSpan(table, trace[sqIdx], magic.magic, magic.shift, kTraceCoverage);
+
+                total.lookups += span.lookups;
+                total.cacheLines += span.cacheLines;
+                total.pages += span.pages;
+            }
+
+            std::cout << piece << " trace: " << total.lookups << " lookups, " << std::fixed << std::setprecision(0)
+                      << kTraceCoverage * 100.0 << "% of them served from " << total.cacheLines << " cache lines and "
+                      << total.pages << " pages" << std::defaultfloat << std::endl;
+        }
+
+        // the descent stops at the first failure, so a square solved some number of
+        // bits below its mask size is solvable at every shift down to that
+        std::array<usize, search::kMaxMaskBits + 1> solvedBelowMask{};
+        usize unsolved{};
+
+        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+            const auto sq = Square::fromRaw(sqIdx);
+
+            if (!allowed.getSquare(sq)) {
+                continue;
+            }
+
+            if (magics[sq.idx()].magic == 0) {
+                ++unsolved;
+            } else {
+                ++solvedBelowMask[tables[sq.idx()].maskBits - (128 - magics[sq.idx()].shift)];
+            }
+        }
+
+        std::cout << piece << " " << search::shapeName(kMagicShape) << " magics:";
+
+        for (usize below = 0; below < solvedBelowMask.size(); ++below) {
+            if (solvedBelowMask[below] > 0) {
+                std::cout << ' ' << solvedBelowMask[below] << " squares at mask size - " << below << ',';
+            }
+        }
+
+        std::cout << ' ' << unsolved << " unsolved" << std::endl;
+
+        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+            const auto sq = Square::fromRaw(sqIdx);
+            if (magics[sq.idx()].magic == 0 && allowed.getSquare(sq)) {
+                return {};
+            }
+        }
+
+        // a magic valid at some shift is valid at every smaller one, as the extra
+        // index bits can only separate occupancies further. so every square can use
+        // the smallest shift any square needs, at the cost of larger tables
+        i32 fixedShift = 128;
+
+        usize variableSize{};
+        usize squareCount{};
+
+        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+            const auto sq = Square::fromRaw(sqIdx);
+
+            if (!allowed.getSquare(sq)) {
+                continue;
+            }
+
+            fixedShift = std::min(fixedShift, magics[sq.idx()].shift);
+
+            variableSize += usize{1} << (128 - magics[sq.idx()].shift);
+            ++squareCount;
+        }
+
+        const auto fixedSize = squareCount << (128 - fixedShift);
+
+        std::cout << piece << ": fixed shift " << fixedShift << " needs " << fixedSize << " table entries, "
+                  << variableSize << " with variable shifts (" << std::fixed << std::setprecision(2)
+                  << static_cast<f64>(fixedSize) / static_cast<f64>(variableSize) << "x)" << std::defaultfloat
+                  << std::endl;
+
+        const auto tag = schemeTag(magics);
+
+        std::ofstream stream{std::string{piece} + "_" + std::string{tag} + "_magic.txt", std::ios::binary};
+
+        if (tag == "mixed") {
+            writeSquares(stream, piece, "BlackMagic", [&](Square sq) {
+                return magics[sq.idx()].scheme == search::MagicScheme::kBlack ? "true" : "false";
+            });
+        } else {
+            stream << "constexpr bool k" << piece << "BlackMagic = " << (tag == "black" ? "true" : "false") << ";\n\n";
+        }
+
+        if constexpr (kFixedShift) {
+            for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+                const auto sq = Square::fromRaw(sqIdx);
+
+                if (allowed.getSquare(sq)) {
+                    magics[sq.idx()].shift = fixedShift;
+                }
+            }
+
+            stream << "constexpr i32 k" << piece << "Shift = " << fixedShift << ";\n\n";
+        } else {
+            writeSquares(stream, piece, "Shifts", [&](Square sq) { return magics[sq.idx()].shift; });
+        }
+
+        // max index + 1, rather than the 2^bits the shift allows
+        std::array<usize, Squares::kCount> tableSizes{};
+
+        usize totalSize{};
+        usize totalFullSize{};
+
+        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+            const auto sq = Square::fromRaw(sqIdx);
+
+            if (!allowed.getSquare(sq)) {
+                continue;
+            }
+
+            const auto& magic = magics[sq.idx()];
+
+            const auto table = search::withScheme(tables[sq.idx()], magic.scheme);
+            tableSizes[sq.idx()] = search::tableSpan(table, magic.magic, magic.shift).maxIndex + 1;
+
+            totalSize += tableSizes[sq.idx()];
+            totalFullSize += usize{1} << (128 - magic.shift);
+        }
+
+        writeSquares(stream, piece, "TableSizes", [&](Square sq) { return tableSizes[sq.idx()]; });
+
+        std::cout << piece << ": " << totalSize << " table entries, " << totalFullSize << " at full size" << std::endl;
+
+        stream << std::hex;
+        stream << "constexpr std::array k" << piece << "Magics = {";
+
+        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+            const auto sq = Square::fromRaw(sqIdx);
 
             const u64 high = magics[sq.idx()].magic >> 64;
             const u64 low = magics[sq.idx()].magic;
@@ -215,24 +1264,875 @@ namespace {
         stream << "\n};\n";
 
         std::cout << "wrote out " << piece << " magics" << std::endl;
+
+        return PieceMagics{
+            .piece = piece,
+            .allowed = allowed,
+            .tables = std::move(tables),
+            .magics = magics,
+        };
+    }
+
+    // interleaves every piece's tables into one attack table, largest tables first
+    void packTables(const std::vector<PieceMagics>& pieces) {
+        struct Entry {
+            usize piece;
+            Square sq;
+            search::SlotList slots;
+            usize span;
+        };
+
+        std::vector<Entry> entries{};
+
+        usize unpackedSize{};
+        // entries holding attacks, which no placement can pack below without sharing them
+        usize slotCount{};
+
+        for (usize pieceIdx = 0; pieceIdx < pieces.size(); ++pieceIdx) {
+            const auto& piece = pieces[pieceIdx];
+
+            for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+                const auto sq = Square::fromRaw(sqIdx);
+
+                if (!piece.allowed.getSquare(sq)) {
+                    continue;
+                }
+
+                auto slots = search::slotList(piece.tables[sq.idx()], piece.magics[sq.idx()]);
+
+                usize span{};
+
+                for (const auto& [idx, attacks] : slots) {
+                    span = std::max(span, idx + 1);
+                }
+
+                unpackedSize += span;
+                slotCount += slots.size();
+
+                entries.push_back({pieceIdx, sq, std::move(slots), span});
+            }
+        }
+
+        std::ranges::stable_sort(entries, std::ranges::greater{}, &Entry::span);
+
+        std::vector<std::array<usize, Squares::kCount>> offsets(pieces.size());
+        search::TablePacker packer{};
+
+        for (const auto& entry : entries) {
+            offsets[entry.piece][entry.sq.idx()] = packer.place(entry.slots);
+        }
+
+        std::vector<search::Magic> allMagics{};
+
+        for (const auto& piece : pieces) {
+            allMagics.insert(allMagics.end(), piece.magics.begin(), piece.magics.end());
+        }
+
+        std::ofstream stream{std::string{schemeTag(allMagics)} + "_offsets.txt", std::ios::binary};
+
+        for (usize pieceIdx = 0; pieceIdx < pieces.size(); ++pieceIdx) {
+            writeSquares(stream, pieces[pieceIdx].piece, "Offsets", [&](Square sq) {
+                return offsets[pieceIdx][sq.idx()];
+            });
+        }
+
+        stream << "constexpr usize kAttackTableSize = " << packer.size() << ";\n";
+
+        std::cout << "packed attack table: " << packer.size() << " entries, " << unpackedSize << " unpacked ("
+                  << std::fixed << std::setprecision(1)
+                  << static_cast<f64>(packer.size()) / static_cast<f64>(unpackedSize) * 100.0 << "%), "
+                  << slotCount << " in use" << std::defaultfloat << std::endl;
+        std::cout << "wrote out offsets" << std::endl;
+    }
+
+    // searches magics for the folded 64-bit scheme (see folded.h) with random
+    // candidates, descending from each square's mask size to its lower bound like findOptimalMagic
+    void findFoldedMagics(
+        std::string_view piece,
+        const attacks::pext::internal::PieceData& data,
+        const auto& attackGetter,
+        Bitboard allowed = Bitboards::kAll
+    ) {
+        std::array<std::optional<std::pair<u64, i32>>, Squares::kCount> magics{};
+        std::mutex magicMutex{};
+
+        search::Stats pieceStats{};
+
+        const auto tables = buildSquareTables(data, attackGetter, allowed);
+
+        util::BlockingQueue<Square> queue{};
+
+        std::vector<std::thread> threads{};
+        threads.reserve(kThreads);
+
+        for (i32 i = 0; i < kThreads; ++i) {
+            threads.emplace_back([&] {
+                search::Scratch scratch{};
+                search::Stats stats{};
+
+                while (true) {
+                    const auto sq = queue.wait();
+
+                    if (!sq) {
+                        const std::scoped_lock lock{magicMutex};
+                        pieceStats.merge(stats);
+                        break;
+                    }
+
+                    const auto& table = tables[sq.idx()];
+
+                    if (!search::foldable(table)) {
+                        const std::scoped_lock lock{magicMutex};
+                        std::cerr << "folding aliases " << piece << " subsets for square " << sq << std::endl;
+                        continue;
+                    }
+
+                    std::optional<std::pair<u64, i32>> best{};
+
+                    for (i32 bits = table.maskBits; bits >= table.minBits(); --bits) {
+                        util::rng::Jsf64Rng rng{kSeed};
+
+                        const auto magic = search::withClassType(table, [&]<typename Class>(Class) {
+                            return search::searchFolded<Class>(table, bits, kAttempts, scratch, stats, rng);
+                        });
+
+                        if (!magic) {
+                            break;
+                        }
+
+                        best = {*magic, 64 - bits};
+                    }
+
+                    const std::scoped_lock lock{magicMutex};
+
+                    if (best) {
+                        std::cout << "found folded " << piece << " magic for " << sq << " with shift " << best->second
+                                  << std::endl;
+                        magics[sq.idx()] = best;
+                    } else {
+                        std::cerr << "failed to find folded " << piece << " magic for square " << sq << std::endl;
+                    }
+                }
+            });
+        }
+
+        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+            const auto sq = Square::fromRaw(sqIdx);
+
+            if (allowed.getSquare(sq)) {
+                queue.push(sq);
+            }
+        }
+
+        for (i32 i = 0; i < kThreads; ++i) {
+            queue.push(Squares::kNone);
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        std::cout << piece << " folded: " << pieceStats.candidates << " candidates, " << std::fixed
+                  << std::setprecision(2) << pieceStats.subsetsPerRejection() << " subsets per rejected candidate"
+                  << std::defaultfloat << std::endl;
+
+        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+            const auto sq = Square::fromRaw(sqIdx);
+            if (!magics[sq.idx()] && allowed.getSquare(sq)) {
+                return;
+            }
+        }
+
+        std::ofstream stream{std::string{piece} + "_folded_magic.txt", std::ios::binary};
+
+        writeSquares(stream, piece, "FoldedShifts", [&](Square sq) {
+            return magics[sq.idx()] ? magics[sq.idx()]->second : 0;
+        });
+
+        stream << std::hex;
+        stream << "constexpr std::array k" << piece << "FoldedMagics = {";
+
+        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+            const auto sq = Square::fromRaw(sqIdx);
+            stream << "\n    UINT64_C(0x" << (magics[sq.idx()] ? magics[sq.idx()]->first : 0) << "),";
+        }
+
+        stream << "\n};\n";
+
+        std::cout << "wrote out folded " << piece << " magics" << std::endl;
+    }
+
+    // greedy set cover: rounds of random candidates scored on how many unserved
+    // squares each is valid for, keeping the best of each round, until every
+    // square is served or a round serves none
+    void findSharedMagics(
+        std::string_view piece,
+        const attacks::pext::internal::PieceData& data,
+        const auto& attackGetter,
+        Bitboard allowed = Bitboards::kAll
+    ) {
+        auto tables = buildSquareTables(data, attackGetter, allowed);
+
+        for (auto& table : tables) {
+            table = search::withScheme(table, kSharedScheme);
+        }
+
+        std::vector<search::SharedTarget> targets{};
+        std::vector<usize> pending{};
+
+        for (i32 sqIdx = 0; sqIdx < Squares::kCount; ++sqIdx) {
+            const auto sq = Square::fromRaw(sqIdx);
+
+            if (!allowed.getSquare(sq)) {
+                continue;
+            }
+
+            pending.push_back(targets.size());
+            targets.push_back({&tables[sq.idx()], tables[sq.idx()].maskBits + kSharedExtraBits});
+        }
+
+        std::vector<u128> sharedMagics{};
+        std::array<i32, Squares::kCount> magicIndices{};
+        magicIndices.fill(-1);
+
+        usize candidates{};
+
+        while (!pending.empty() && sharedMagics.size() < kSharedMaxMagics) {
+            const auto round = sharedMagics.size();
+
+            std::vector<std::pair<usize, u128>> best(kThreads);
+
+            std::vector<std::thread> threads{};
+            threads.reserve(kThreads);
+
+            for (i32 i = 0; i < kThreads; ++i) {
+                threads.emplace_back([&, i] {
+                    search::Scratch scratch{};
+                    util::rng::Jsf64Rng rng{kSeed + round * kThreads + i};
+
+                    for (usize attempt = 0; attempt < kSharedAttempts / kThreads; ++attempt) {
+                        const auto magic = search::generateCandidate(kStrategy, rng);
+                        const auto score = search::sharedScore(targets, pending, magic, kPrefilter, scratch);
+
+                        if (score > best[i].first) {
+                            best[i] = {score, magic};
+                        }
+                    }
+                });
+            }
+
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            candidates += kSharedAttempts / kThreads * kThreads;
+
+            const auto [score, magic] = *std::ranges::max_element(best, {}, &std::pair<usize, u128>::first);
+
+            if (score == 0) {
+                break;
+            }
+
+            search::Scratch scratch{};
+
+            std::erase_if(pending, [&](usize targetIdx) {
+                if (!search::validFor(targets[targetIdx], magic, kPrefilter, scratch)) {
+                    return false;
+                }
+
+                magicIndices[targets[targetIdx].table->sq.idx()] = static_cast<i32>(sharedMagics.size());
+                return true;
+            });
+
+            sharedMagics.push_back(magic);
+
+            std::cout << piece << " shared magic " << round << " serves " << score << " squares, " << pending.size()
+                      << " left" << std::endl;
+        }
+
+        std::cout << piece << ": " << sharedMagics.size() << " shared magics, " << candidates << " candidates"
+                  << std::endl;
+
+        // squares no shared candidate happened to serve get magics of their own
+        if (!pending.empty()) {
+            search::Scratch scratch{};
+            search::Stats stats{};
+
+            search::AttemptPool pool{};
+            search::LevelStats levels{};
+
+            const SquareProgress unsolved{};
+
+            std::erase_if(pending, [&](usize targetIdx) {
+                const auto& target = targets[targetIdx];
+
+                search::LevelBudget budget{pool, levels, kBudgetParams, 0, kAttempts, 1.0};
+                const auto magic = findMagicRandom(*target.table, target.bits, 0, unsolved, budget, scratch, stats);
+
+                if (!magic) {
+                    return false;
+                }
+
+                magicIndices[target.table->sq.idx()] = static_cast<i32>(sharedMagics.size());
+                sharedMagics.push_back(*magic);
+
+                return true;
+            });
+
+            std::cout << piece << ": " << sharedMagics.size() << " magics including single-square ones" << std::endl;
+        }
+
+        if (!pending.empty()) {
+            std::cerr << "failed to serve " << pending.size() << " " << piece << " squares" << std::endl;
+            return;
+        }
+
+        std::ofstream stream{
+            std::string{piece} + "_" + std::string{search::schemeName(kSharedScheme)} + "_shared_magic.txt",
+            std::ios::binary
+        };
+
+        // tables laid out back to back in square order
+        std::array<usize, Squares::kCount> offsets{};
+        usize tableSize{};
+
+        for (const auto& target : targets) {
+            offsets[target.table->sq.idx()] = tableSize;
+            tableSize += usize{1} << target.bits;
+        }
+
+        // squares the piece never stands on get 0
+        writeSquares(stream, piece, "Shifts", [&](Square sq) {
+            return allowed.getSquare(sq) ? 128 - tables[sq.idx()].maskBits - kSharedExtraBits : 0;
+        });
+        writeSquares(stream, piece, "MagicIndices", [&](Square sq) {
+            return allowed.getSquare(sq) ? magicIndices[sq.idx()] : 0;
+        });
+        writeSquares(stream, piece, "Offsets", [&](Square sq) {
+            return allowed.getSquare(sq) ? offsets[sq.idx()] : 0;
+        });
+
+        stream << std::hex;
+        stream << "constexpr std::array k" << piece << "SharedMagics = {";
+
+        for (const auto magic : sharedMagics) {
+            const u64 high = magic >> 64;
+            const u64 low = magic;
+
+            stream << "\n    U128(0x" << high << ", 0x" << low << "),";
+        }
+
+        stream << "\n};\n";
+
+        std::cout << "wrote out shared " << piece << " magics" << std::endl;
+    }
+
+    // makes the compiler assume value is read, so that the work computing it is not optimised out
+    template <typename T>
+    void doNotOptimize(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    struct BenchResult {
+        search::Stats stats{};
+        usize hits{};
+        f64 seconds{};
+
+        [[nodiscard]] f64 candidatesPerSecond() const {
+            return static_cast<f64>(stats.candidates) / seconds;
+        }
+    };
+
+    // searches one bit below each square's mask size, where nearly every candidate is rejected
+    [[nodiscard]] BenchResult benchSearch(
+        const std::vector<search::SquareTable>& tables,
+        search::Scratch& scratch,
+        const auto& search
+    ) {
+        BenchResult result{};
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (const auto& table : tables) {
+            if (table.mask == 0) {
+                continue;
+            }
+
+            const auto bits = std::max(table.maskBits - 1, 1);
+
+            search::FixedSource source{kSeed, kStrategy};
+
+            const auto onValid = [&](u128) {
+                ++result.hits;
+                return false;
+            };
+
+            scratch.order.reset(table);
+
+            search::withClassType(table, [&]<typename Class>(Class) {
+                search.template operator()<Class>(table, bits, scratch, result.stats, source, onValid);
+            });
+        }
+
+        result.seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+        return result;
+    }
+
+    template <search::OccupancyOrder kBenchOrder>
+    [[nodiscard]] BenchResult benchWalk(
+        const std::vector<search::SquareTable>& tables,
+        search::Scratch& scratch,
+        const search::Prefilter& prefilter = {}
+    ) {
+        return benchSearch(
+            tables,
+            scratch,
+            [&]<typename Class>(const search::SquareTable& table, i32 bits, auto&... args) {
+                search::searchScalar<kBenchOrder, Class>(table, bits, kBenchCandidates, prefilter, args...);
+            }
+        );
+    }
+
+    template <search::OccupancyOrder kBenchOrder>
+    [[nodiscard]] BenchResult benchSpecialized(
+        const std::vector<search::SquareTable>& tables,
+        search::Scratch& scratch,
+        const search::Prefilter& prefilter = {}
+    ) {
+        return benchSearch(
+            tables,
+            scratch,
+            [&]<typename Class>(const search::SquareTable& table, i32 bits, auto&... args) {
+                search::withMaskBits(table, [&]<i32 kMaskBits>(std::integral_constant<i32, kMaskBits>) {
+                    search::searchScalar<kBenchOrder, Class, usize{1} << kMaskBits>(
+                        table,
+                        bits,
+                        kBenchCandidates,
+                        prefilter,
+                        args...
+                    );
+                });
+            }
+        );
+    }
+
+    [[nodiscard]] BenchResult benchSimd(
+        const std::vector<search::SquareTable>& tables,
+        search::Scratch& scratch,
+        const search::Prefilter& prefilter
+    ) {
+        return benchSearch(
+            tables,
+            scratch,
+            [&]<typename Class>(const search::SquareTable& table, i32 bits, auto&... args) {
+                search::searchSimd(table, bits, kBenchCandidates, prefilter, args...);
+            }
+        );
+    }
+
+    struct PrefilterAccuracy {
+        usize candidates{};
+        usize rejected{};
+        usize valid{};
+        usize falseRejects{};
+    };
+
+    // runs every candidate through both the prefilter and the full test at each
+    // square's full mask size, where valid magics are common enough to count
+    [[nodiscard]] PrefilterAccuracy benchPrefilterAccuracy(
+        const std::vector<search::SquareTable>& tables,
+        search::Scratch& scratch,
+        const search::Prefilter& prefilter
+    ) {
+        PrefilterAccuracy result{};
+
+        for (const auto& table : tables) {
+            if (table.mask == 0) {
+                continue;
+            }
+
+            const auto bits = table.maskBits;
+
+            search::withClassType(table, [&]<typename Class>(Class) {
+                util::rng::Jsf64Rng rng{kSeed};
+
+                auto& used = scratch.table<Class>();
+                used.reset(bits);
+
+                scratch.order.reset(table);
+
+                for (usize i = 0; i < kBenchCandidates; ++i) {
+                    const auto candidate = search::generateCandidate(kStrategy, rng);
+
+                    const bool accepted = prefilter.accepts(table, candidate, bits);
+                    const bool valid =
+                        search::testMagic<kOrder, Class>(table, candidate, 128 - bits, scratch) == table.size();
+
+                    ++result.candidates;
+
+                    if (!accepted) {
+                        ++result.rejected;
+                    }
+
+                    if (valid) {
+                        ++result.valid;
+
+                        if (!accepted) {
+                            ++result.falseRejects;
+                        }
+                    }
+
+                    used.nextEpoch();
+                }
+            });
+        }
+
+        return result;
+    }
+
+    // valid magics found at each square's full mask size by every strategy alone and by the bandit
+    void benchStrategies(
+        std::string_view piece,
+        const std::vector<search::SquareTable>& tables,
+        search::Scratch& scratch
+    ) {
+        const auto countHits = [&](const auto& makeSource) {
+            usize hits{};
+
+            for (const auto& table : tables) {
+                if (table.mask == 0) {
+                    continue;
+                }
+
+                auto source = makeSource();
+                search::Stats stats{};
+
+                const auto onValid = [&](u128) {
+                    ++hits;
+                    return false;
+                };
+
+                scratch.order.reset(table);
+
+                search::withClassType(table, [&]<typename Class>(Class) {
+                    search::searchScalar<kOrder, Class>(
+                        table,
+                        table.maskBits,
+                        kBenchCandidates,
+                        kPrefilter,
+                        scratch,
+                        stats,
+                        source,
+                        onValid
+                    );
+                });
+            }
+
+            return hits;
+        };
+
+        std::cout << piece << " valid magics per strategy:";
+
+        for (usize i = 0; i < search::kStrategyCount; ++i) {
+            const auto strategy = static_cast<search::Strategy>(i);
+            const auto hits = countHits([&] { return search::FixedSource{kSeed, strategy}; });
+
+            std::cout << ' ' << search::strategyName(strategy) << ' ' << hits;
+        }
+
+        std::cout << " bandit " << countHits([&] { return search::BanditSource{kSeed}; }) << std::endl;
+    }
+
+    // squares solved one bit below their mask size by each engine on its own bench budget
+    void benchEngines(
+        std::string_view piece,
+        const std::vector<search::SquareTable>& tables,
+        search::Scratch& scratch
+    ) {
+        constexpr search::AnnealParams kBenchAnnealParams{
+            .iterations = kBenchAnnealIterations,
+            .runLength = kAnnealParams.runLength,
+            .startTemperature = kAnnealParams.startTemperature,
+            .endTemperature = kAnnealParams.endTemperature,
+        };
+
+        constexpr search::GeneticParams kBenchGeneticParams{
+            .generations = kBenchGenerations,
+            .populationSize = kGeneticParams.populationSize,
+            .tournamentSize = kGeneticParams.tournamentSize,
+            .mutationBits = kGeneticParams.mutationBits,
+        };
+
+        const auto countSolved = [&](const auto& find) {
+            usize solved{};
+            usize squares{};
+
+            const auto start = std::chrono::steady_clock::now();
+
+            for (const auto& table : tables) {
+                if (table.mask == 0 || table.maskBits < 2) {
+                    continue;
+                }
+
+                ++squares;
+
+                search::Stats stats{};
+
+                if (find(table, table.maskBits - 1, stats)) {
+                    ++solved;
+                }
+            }
+
+            const auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << solved << "/" << squares << " squares in " << std::fixed << std::setprecision(2) << seconds
+                      << "s" << std::defaultfloat;
+        };
+
+        std::cout << piece << " squares solved at popcount - 1: random ";
+
+        countSolved([&](const search::SquareTable& table, i32 bits, search::Stats& stats) {
+            search::FixedSource source{kSeed, kStrategy};
+
+            bool found = false;
+
+            scratch.order.reset(table);
+
+            search::withClassType(table, [&]<typename Class>(Class) {
+                search::searchScalar<kOrder, Class>(
+                    table,
+                    bits,
+                    kBenchCandidates * 10,
+                    kPrefilter,
+                    scratch,
+                    stats,
+                    source,
+                    [&](u128) { return found = true; }
+                );
+            });
+
+            return found;
+        });
+
+        std::cout << ", anneal ";
+
+        countSolved([&](const search::SquareTable& table, i32 bits, search::Stats& stats) {
+            return findMagicAnneal(table, bits, kBenchAnnealParams, scratch, stats).has_value();
+        });
+
+        std::cout << ", genetic ";
+
+        countSolved([&](const search::SquareTable& table, i32 bits, search::Stats& stats) {
+            return findMagicGenetic(table, bits, kBenchGeneticParams, {}, scratch, stats).has_value();
+        });
+
+        std::cout << std::endl;
+    }
+
+    // lookup latency of the index schemes. every square gets a table at its mask size
+    // and a random magic - valid magics would take a search, and do not change the
+    // work a lookup does - so only the pext lookups return real attacks
+    void benchLookups(
+        std::string_view piece,
+        const std::vector<search::SquareTable>& tables,
+        const auto& attackGetter
+    ) {
+        constexpr usize kQueries = 1 << 16;
+        constexpr usize kRepeats = 256;
+
+        struct Magic128 {
+            u128 mask;
+            u128 keyBits;
+            u128 magic;
+            i32 shift;
+            usize offset;
+        };
+
+        util::rng::Jsf64Rng rng{kSeed};
+
+        std::vector<Magic128> magics128(tables.size());
+        std::vector<search::FoldedSquare> foldedMagics(tables.size());
+
+        std::vector<Square> squares{};
+        usize tableSize{};
+
+        for (const auto& table : tables) {
+            if (table.mask == 0) {
+                continue;
+            }
+
+            squares.push_back(table.sq);
+
+            magics128[table.sq.idx()] = {
+                .mask = table.mask,
+                .keyBits = table.keyBits,
+                .magic = rng.nextU128() & rng.nextU128() & rng.nextU128(),
+                .shift = 128 - table.maskBits,
+                .offset = tableSize,
+            };
+
+            foldedMagics[table.sq.idx()] = {
+                .mask = table.mask,
+                .magic = rng.nextU64() & rng.nextU64() & rng.nextU64(),
+                .shift = 64 - table.maskBits,
+                .offset = tableSize,
+            };
+
+            tableSize += usize{1} << table.maskBits;
+        }
+
+        const std::vector<Bitboard> attackTable(tableSize);
+
+        std::vector<std::pair<Square, Bitboard>> queries{};
+        queries.reserve(kQueries);
+
+        for (usize i = 0; i < kQueries; ++i) {
+            const auto sq = squares[rng.nextU32(static_cast<u32>(squares.size()))];
+            const auto occ = Bitboard{rng.nextU128() & rng.nextU128()} & Bitboards::kAll;
+
+            queries.emplace_back(sq, occ);
+        }
+
+        const auto time = [&](std::string_view scheme, const auto& lookup) {
+            u128 sink{};
+
+            const auto start = std::chrono::steady_clock::now();
+
+            for (usize repeat = 0; repeat < kRepeats; ++repeat) {
+                for (const auto& [sq, occ] : queries) {
+                    sink ^= lookup(sq, occ).raw();
+                }
+            }
+
+            const auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+            doNotOptimize(sink);
+
+            std::cout << ' ' << scheme << ' ' << std::fixed << std::setprecision(2)
+                      << seconds * 1e9 / static_cast<f64>(kQueries * kRepeats) << "ns" << std::defaultfloat;
+        };
+
+        std::cout << piece << " lookups:";
+
+        time("u128", [&](Square sq, Bitboard occ) {
+            const auto& magic = magics128[sq.idx()];
+            const auto idx = search::getIdx(magic.keyBits, occ.raw() & magic.mask, magic.magic, magic.shift);
+            return attackTable[magic.offset + idx];
+        });
+
+        time("folded", [&](Square sq, Bitboard occ) {
+            return attackTable[foldedMagics[sq.idx()].index(occ.raw())];
+        });
+
+        time("pext", [&](Square sq, Bitboard occ) { return attackGetter(sq, occ); });
+
+        std::cout << std::endl;
+    }
+
+    void benchPiece(
+        std::string_view piece,
+        const attacks::pext::internal::PieceData& data,
+        const auto& attackGetter,
+        Bitboard allowed = Bitboards::kAll
+    ) {
+        const auto tables = buildSquareTables(data, attackGetter, allowed);
+
+        search::Scratch scratch{};
+
+        const auto printResult = [&](std::string_view walk, const BenchResult& result, const BenchResult& baseline) {
+            std::cout << piece << " " << walk << ": " << std::fixed << std::setprecision(0)
+                      << result.candidatesPerSecond() << " candidates/s (" << std::setprecision(2)
+                      << result.candidatesPerSecond() / baseline.candidatesPerSecond() << "x), "
+                      << result.stats.subsetsPerRejection() << " subsets per rejection, " << result.hits << " hits"
+                      << std::defaultfloat << std::endl;
+        };
+
+        const auto rippler = benchWalk<search::OccupancyOrder::kRippler>(tables, scratch);
+        const auto gray = benchWalk<search::OccupancyOrder::kGray>(tables, scratch);
+        const auto failFast = benchWalk<search::OccupancyOrder::kFailFast>(tables, scratch);
+        const auto specialized = benchSpecialized<search::OccupancyOrder::kFailFast>(tables, scratch);
+
+        // every walk sees the same candidates, and whether a candidate is valid does not depend on the order
+        assert(gray.hits == rippler.hits);
+        assert(failFast.hits == rippler.hits);
+        assert(specialized.hits == rippler.hits);
+
+        benchStrategies(piece, tables, scratch);
+        benchEngines(piece, tables, scratch);
+        benchLookups(piece, tables, attackGetter);
+
+        printResult("rippler", rippler, rippler);
+        printResult("gray", gray, rippler);
+        printResult("fail-fast", failFast, rippler);
+        printResult("fail-fast specialized", specialized, rippler);
+
+        if (!kPrefilter.enabled()) {
+            return;
+        }
+
+        const auto prefiltered = benchWalk<kOrder>(tables, scratch, kPrefilter);
+        assert(prefiltered.hits == failFast.hits || kPrefilter.minSpread > 0);
+
+        printResult("prefiltered", prefiltered, rippler);
+
+        if constexpr (search::simd::kAvailable) {
+            const auto simd = benchSimd(tables, scratch, kPrefilter);
+            assert(simd.hits == prefiltered.hits);
+
+            printResult("simd", simd, rippler);
+        }
+
+        const auto accuracy = benchPrefilterAccuracy(tables, scratch, kPrefilter);
+
+        std::cout << piece << " prefilter: " << std::fixed << std::setprecision(2)
+                  << prefiltered.stats.prefilterRate() * 100.0 << "% rejected, " << accuracy.falseRejects << " of "
+                  << accuracy.valid << " valid magics rejected at full mask size" << std::defaultfloat << std::endl;
     }
 } // namespace
 
-int main() {
-    findMagics(
-        "BlackLance",
+int main(int argc, char* argv[]) {
+    const bool bench = argc > 1 && std::string_view{argv[1]} == "bench";
+    const bool folded = argc > 1 && std::string_view{argv[1]} == "folded";
+    const bool shared = argc > 1 && std::string_view{argv[1]} == "shared";
+
+    std::vector<PieceMagics> pieces{};
+    bool failed = false;
+
+    // carried across pieces, so the lances' spare attempts go to the rooks
+    search::AttemptPool pool{};
+
+    const auto run = [&](std::string_view piece,
+                         const attacks::pext::internal::PieceData& data,
+                         const auto& attackGetter,
+                         Bitboard allowed = Bitboards::kAll) {
+        if (bench) {
+            benchPiece(piece, data, attackGetter, allowed);
+        } else if (folded) {
+            findFoldedMagics(piece, data, attackGetter, allowed);
+        } else if (shared) {
+            findSharedMagics(piece, data, attackGetter, allowed);
+        } else if (auto magics = findMagics(piece, data, attackGetter, pool, allowed)) {
+            pieces.push_back(std::move(*magics));
+        } else {
+            failed = true;
+        }
+    };
+
+    run("BlackLance",
         attacks::pext::lanceData(Colors::kBlack),
         [](Square sq, Bitboard occ) { return attacks::lanceAttacks(sq, Colors::kBlack, occ); },
-        ~(Bitboards::kRankA | Bitboards::kRankB)
-    );
+        ~(Bitboards::kRankA | Bitboards::kRankB));
 
-    findMagics(
-        "WhiteLance",
+    run("WhiteLance",
         attacks::pext::lanceData(Colors::kWhite),
         [](Square sq, Bitboard occ) { return attacks::lanceAttacks(sq, Colors::kWhite, occ); },
-        ~(Bitboards::kRankI | Bitboards::kRankH)
-    );
+        ~(Bitboards::kRankI | Bitboards::kRankH));
+
+    run("Bishop", attacks::pext::kBishopData, attacks::bishopAttacks);
+    run("Rook", attacks::pext::kRookData, attacks::rookAttacks);
 
-    findMagics("Bishop", attacks::pext::kBishopData, attacks::bishopAttacks);
-    findMagics("Rook", attacks::pext::kRookData, attacks::rookAttacks);
+    if (!bench && !folded && !shared && !failed) {
+        packTables(pieces);
+    }
 }
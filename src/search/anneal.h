@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <cmath>
+#include <optional>
+
+#include "../util/rng.h"
+#include "candidates.h"
+#include "kernel.h"
+#include "scratch.h"
+#include "square_table.h"
+#include "stats.h"
+
+namespace stoat::search {
+    struct AnnealParams {
+        // total candidate evaluations for one (square, bits) search
+        usize iterations;
+        // evaluations before giving up on a run and restarting from a fresh random candidate
+        usize runLength;
+        // in units of collisions, decayed geometrically over each run
+        f64 startTemperature;
+        f64 endTemperature;
+    };
+
+    // simulated annealing over single bit flips, minimising the collision count.
+    // rather than evaluating a move and then rolling against its acceptance
+    // probability, the roll comes first and sets the worst score that would be
+    // accepted, so most rejected moves stop counting early
+    template <typename Class>
+    [[nodiscard]] std::optional<u128> anneal(
+        const SquareTable& table,
+        i32 bits,
+        const AnnealParams& params,
+        Scratch& scratch,
+        Stats& stats,
+        util::rng::Jsf64Rng& rng
+    ) {
+        const auto shift = 128 - bits;
+
+        auto& used = scratch.table<Class>();
+        used.reset(bits);
+
+        const auto evaluate = [&](u128 magic, usize limit) {
+            ++stats.candidates;
+
+            const auto collisions = countCollisions(table, magic, shift, used, limit);
+            used.nextEpoch();
+
+            return collisions;
+        };
+
+        const auto cooling = std::pow(
+            params.endTemperature / params.startTemperature,
+            1.0 / static_cast<f64>(params.runLength)
+        );
+
+        u128 current{};
+        usize score{};
+
+        f64 temperature{};
+        usize runRemaining = 0;
+
+        for (usize i = 0; i < params.iterations; ++i) {
+            if (runRemaining == 0) {
+                current = generateCandidate(Strategy::kAnd3, rng);
+                score = evaluate(current, table.size());
+
+                temperature = params.startTemperature;
+                runRemaining = params.runLength;
+
+                ++stats.annealRuns;
+            }
+
+            if (score == 0) {
+                return current;
+            }
+
+            const auto candidate = current ^ (u128{1} << rng.nextU32(128));
+
+            // uniform in (0, 1]
+            const auto roll = static_cast<f64>((rng.nextU64() >> 11) + 1) * 0x1.0p-53;
+            const auto limit = score + static_cast<usize>(-temperature * std::log(roll));
+
+            const auto candidateScore = evaluate(candidate, limit);
+
+            if (candidateScore <= limit) {
+                current = candidate;
+                score = candidateScore;
+            }
+
+            temperature *= cooling;
+            --runRemaining;
+        }
+
+        if (score == 0) {
+            return current;
+        }
+
+        return {};
+    }
+} // namespace stoat::search
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+#include "../util/bits.h"
+#include "kernel.h"
+#include "magic.h"
+#include "scratch.h"
+#include "square_table.h"
+#include "stats.h"
+
+namespace stoat::search {
+    struct BacktrackParams {
+        // magics with more set bits than this are not considered
+        i32 maxSetBits;
+        // the top prefixBits bits of the magic are fixed by the caller,
+        // splitting the search into 2^prefixBits independent subtrees
+        i32 prefixBits;
+        // node budget for one (square, bits, prefix) search
+        usize maxNodes;
+    };
+
+    // depth-first search fixing the magic's bits from the most significant down,
+    // trying a clear bit before a set one. with the bits above b fixed to p and
+    // the rest some r < 2^b, an occupancy's product is key * p plus key * r for
+    // white magics, or key * p minus (-key) * r for black ones, where key (or its
+    // negation) is small. once that multiplier times the largest possible r fits
+    // under the index's lowest bit, the product can only vary within an interval,
+    // and if the interval does not cross an index boundary the occupancy's index
+    // is already decided. two decided indices holding different attacks
+    // prune the branch. a search that runs out of tree rather than nodes shows
+    // that no magic exists under the prefix within the set bit limit
+    template <OccupancyOrder kOrder, typename Class>
+    [[nodiscard]] std::optional<u128> backtrack(
+        const SquareTable& table,
+        i32 bits,
+        const BacktrackParams& params,
+        u128 prefix,
+        Scratch& scratch,
+        Stats& stats
+    ) {
+        struct Term {
+            u128 key;
+            // -key for black magics, so that the product moves by
+            // multiplier * r, up for white magics and down for black
+            u128 multiplier;
+            i32 width;
+            AttackClass cls;
+        };
+
+        const auto shift = 128 - bits;
+
+        auto& used = scratch.table<Class>();
+        used.reset(bits);
+
+        scratch.order.reset(table);
+
+        std::vector<Term> terms{};
+        terms.reserve(table.size());
+
+        for (usize occIdx = 0; occIdx < table.size(); ++occIdx) {
+            const auto key = getKey(table.keyBits, table.occupancies[occIdx]);
+            const auto multiplier = table.scheme == MagicScheme::kBlack ? -key : key;
+
+            terms.push_back({key, multiplier, util::bitWidth(multiplier), table.classes[occIdx]});
+        }
+
+        // terms whose index can be decided at a node are then always a prefix
+        std::ranges::sort(terms, {}, &Term::width);
+
+        usize nodes = 0;
+        bool truncated = false;
+
+        const auto clearBelow = [](i32 b) { return b >= 128 ? u128{} : ~u128{} << b; };
+
+        // true if the fixed bits force a collision
+        const auto forced = [&](u128 fixed, i32 free, i32 setBitsLeft) {
+            // largest r with at most setBitsLeft set bits below bit `free`
+            const auto maxR =
+                setBitsLeft >= free ? ~clearBelow(free) : ~clearBelow(free) & clearBelow(free - setBitsLeft);
+            const auto maxRWidth = util::bitWidth(maxR);
+
+            bool collision = false;
+
+            for (const auto& term : terms) {
+                // the product could move by a whole index or more
+                if (term.width + maxRWidth > shift) {
+                    break;
+                }
+
+                const auto spread = term.multiplier * maxR;
+
+                const auto base = term.key * fixed;
+                const auto low = table.scheme == MagicScheme::kBlack ? base - spread : base;
+                const auto high = low + spread;
+
+                // wrapped around from the last index to the first
+                if (high < low) {
+                    continue;
+                }
+
+                const auto idx = static_cast<usize>(low >> shift);
+
+                if (idx != static_cast<usize>(high >> shift)) {
+                    continue;
+                }
+
+                if (!used.insert(idx, static_cast<Class>(term.cls))) {
+                    collision = true;
+                    break;
+                }
+            }
+
+            used.nextEpoch();
+
+            return collision;
+        };
+
+        std::optional<u128> found{};
+
+        const auto search = [&](const auto& self, u128 fixed, i32 free, i32 setBitsLeft) -> bool {
+            if (nodes >= params.maxNodes) {
+                truncated = true;
+                return false;
+            }
+
+            ++nodes;
+
+            // every remaining bit is clear, so the magic is fully decided
+            if (free == 0 || setBitsLeft == 0) {
+                ++stats.candidates;
+
+                const auto pos = testMagic<kOrder, Class>(table, fixed, shift, scratch);
+                used.nextEpoch();
+
+                if (pos == table.size()) {
+                    found = fixed;
+                    return true;
+                }
+
+                ++stats.rejected;
+                stats.rejectedSubsets += pos + 1;
+
+                return false;
+            }
+
+            if (forced(fixed, free, setBitsLeft)) {
+                ++stats.backtrackPrunes;
+                return false;
+            }
+
+            const auto bit = u128{1} << (free - 1);
+
+            return self(self, fixed, free - 1, setBitsLeft) || self(self, fixed | bit, free - 1, setBitsLeft - 1);
+        };
+
+        const auto prefixSetBits = util::popcount(prefix);
+
+        if (prefixSetBits <= params.maxSetBits) {
+            const auto fixed = params.prefixBits == 0 ? u128{} : prefix << (128 - params.prefixBits);
+            search(search, fixed, 128 - params.prefixBits, params.maxSetBits - prefixSetBits);
+        }
+
+        stats.backtrackNodes += nodes;
+
+        if (!found && !truncated) {
+            ++stats.backtrackExhausted;
+        }
+
+        return found;
+    }
+} // namespace stoat::search
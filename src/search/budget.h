@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <optional>
+
+#include "square_table.h"
+#include "stats.h"
+
+namespace stoat::search {
+    struct BudgetParams {
+        // attempts drawn between estimates
+        usize chunk;
+        // a level stops once its estimated chance of finding a magic with the
+        // attempts it may still draw falls below this
+        f64 minSuccessProbability;
+        // a level may draw up to this many times its own budget, the excess
+        // coming from attempts given up by levels that stopped early
+        f64 maxScale;
+        // how much rarer magics are assumed to be one bit below a square's
+        // last level, before other squares have been seen at that level
+        f64 initialDecline;
+    };
+
+    // attempts given up by levels that stopped early, shared by every square
+    // and piece so that hard squares can spend what easy ones did not
+    class AttemptPool {
+    public:
+        void deposit(usize attempts) {
+            m_credit.fetch_add(attempts, std::memory_order::relaxed);
+        }
+
+        // takes up to `attempts`, returning how many were available
+        [[nodiscard]] usize withdraw(usize attempts) {
+            auto credit = m_credit.load(std::memory_order::relaxed);
+            usize taken{};
+
+            do {
+                taken = std::min(credit, attempts);
+            } while (!m_credit.compare_exchange_weak(credit, credit - taken, std::memory_order::relaxed));
+
+            return taken;
+        }
+
+        [[nodiscard]] usize credit() const {
+            return m_credit.load(std::memory_order::relaxed);
+        }
+
+    private:
+        std::atomic<usize> m_credit{};
+    };
+
+    // attempts spent and magics found at each number of bits below the mask
+    // size, over every square of a piece finished so far with one scheme
+    class LevelStats {
+    public:
+        void record(i32 belowMask, usize attempts, bool found) {
+            m_attempts[belowMask].fetch_add(attempts, std::memory_order::relaxed);
+
+            if (found) {
+                m_found[belowMask].fetch_add(1, std::memory_order::relaxed);
+            }
+        }
+
+        // per-candidate success rate, with a square's own prediction counting
+        // as one magic found in 1 / priorRate attempts, and `pending` attempts
+        // of a level still running counted as failures
+        [[nodiscard]] f64 rate(i32 belowMask, f64 priorRate, usize pending) const {
+            const auto found = static_cast<f64>(m_found[belowMask].load(std::memory_order::relaxed));
+            const auto attempts = static_cast<f64>(m_attempts[belowMask].load(std::memory_order::relaxed));
+
+            return (found + 1.0) / (attempts + static_cast<f64>(pending) + 1.0 / priorRate);
+        }
+
+    private:
+        std::array<std::atomic<usize>, kMaxMaskBits + 1> m_attempts{};
+        std::array<std::atomic<usize>, kMaxMaskBits + 1> m_found{};
+    };
+
+    // a square's success rate at the last level it searched, from the attempts
+    // that level took to find its magic, or spent failing to
+    class LevelHistory {
+    public:
+        void record(usize attempts) {
+            m_rate = 1.0 / static_cast<f64>(std::max<usize>(attempts, 1));
+        }
+
+        // with nothing recorded yet, assumes the level is easy
+        [[nodiscard]] f64 predictedRate(const BudgetParams& params) const {
+            return m_rate ? *m_rate / params.initialDecline : 1.0;
+        }
+
+    private:
+        std::optional<f64> m_rate{};
+    };
+
+    // chance of at least one success in `attempts` independent tries
+    [[nodiscard]] inline f64 successProbability(f64 rate, usize attempts) {
+        return -std::expm1(std::log1p(-std::min(rate, 1.0)) * static_cast<f64>(attempts));
+    }
+
+    // hands out one level's attempts in chunks, stopping once success looks
+    // unlikely and borrowing from the pool once its own budget runs out
+    class LevelBudget {
+    public:
+        LevelBudget(
+            AttemptPool& pool,
+            LevelStats& levels,
+            const BudgetParams& params,
+            i32 belowMask,
+            usize attempts,
+            f64 predictedRate
+        ) :
+                m_pool{pool},
+                m_levels{levels},
+                m_params{params},
+                m_belowMask{belowMask},
+                m_attempts{attempts},
+                m_limit{static_cast<usize>(static_cast<f64>(attempts) * params.maxScale)},
+                m_predictedRate{predictedRate} {}
+
+        // the level's own budget, before any borrowing
+        [[nodiscard]] usize attempts() const {
+            return m_attempts;
+        }
+
+        // attempts to draw next, or 0 if the level should stop
+        [[nodiscard]] usize next(Stats& stats) {
+            m_driven = true;
+
+            if (m_drawn >= m_limit) {
+                return 0;
+            }
+
+            // what is left of the level's own budget, and what it could borrow
+            const auto own = m_attempts - std::min(m_drawn, m_attempts);
+            const auto available = std::min(m_limit - m_drawn, own + m_pool.credit());
+
+            if (available == 0) {
+                return 0;
+            }
+
+            const auto rate = m_levels.rate(m_belowMask, m_predictedRate, m_drawn);
+
+            if (successProbability(rate, available) < m_params.minSuccessProbability) {
+                ++stats.budgetStops;
+                return 0;
+            }
+
+            const auto chunk = std::min(m_params.chunk, m_limit - m_drawn);
+
+            const auto fromOwn = std::min(chunk, own);
+            const auto borrowed = chunk > fromOwn ? m_pool.withdraw(chunk - fromOwn) : 0;
+
+            stats.budgetBorrowed += borrowed;
+            m_drawn += fromOwn + borrowed;
+
+            return fromOwn + borrowed;
+        }
+
+        // records the attempts the level actually spent. a failed level drawn
+        // through next() gives up what it did not draw of its own budget, unless
+        // it was cancelled because another search of the same square found a
+        // magic at this level. engines that spend their own way give up nothing
+        void finish(usize spent, bool found, bool cancelled = false) {
+            m_levels.record(m_belowMask, spent, found);
+
+            if (m_driven && !found && !cancelled && m_drawn < m_attempts) {
+                m_pool.deposit(m_attempts - m_drawn);
+            }
+        }
+
+    private:
+        AttemptPool& m_pool;
+        LevelStats& m_levels;
+        const BudgetParams& m_params;
+
+        i32 m_belowMask;
+        usize m_attempts;
+        usize m_limit;
+        f64 m_predictedRate;
+
+        usize m_drawn{};
+        bool m_driven{};
+    };
+} // namespace stoat::search
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <string_view>
+
+#include "../util/rng.h"
+
+namespace stoat::search {
+    enum class Strategy : u8 {
+        // and of 2, 3 or 4 random words - roughly 1/4, 1/8 and 1/16 of bits set
+        kAnd2,
+        kAnd3,
+        kAnd4,
+        // an and3 or'd with an and4, about 3/16 of bits set
+        kAnd3OrAnd4,
+        // between kSparseMinBits and kSparseMaxBits random bits set
+        kSparse,
+        // dense high word, sparse low word. key.low * magic.high lands in the
+        // top word of the product without a carry, so a dense magic.high mixes
+        // occupancies in the key's low word straight into the index. keys
+        // varying only in their high word reach it through magic.low alone,
+        // which this keeps sparse, so it suits masks in the low 64 bits
+        kHighBiased,
+    };
+
+    constexpr usize kStrategyCount = 6;
+
+    constexpr i32 kSparseMinBits = 4;
+    constexpr i32 kSparseMaxBits = 20;
+
+    [[nodiscard]] constexpr std::string_view strategyName(Strategy strategy) {
+        switch (strategy) {
+            case Strategy::kAnd2:
+                return "and2";
+            case Strategy::kAnd3:
+                return "and3";
+            case Strategy::kAnd4:
+                return "and4";
+            case Strategy::kAnd3OrAnd4:
+                return "and3|and4";
+            case Strategy::kSparse:
+                return "sparse";
+            case Strategy::kHighBiased:
+                return "high-biased";
+            default:
+                assert(false);
+                return "?";
+        }
+    }
+
+    [[nodiscard]] inline u128 generateCandidate(Strategy strategy, util::rng::Jsf64Rng& rng) {
+        switch (strategy) {
+            case Strategy::kAnd2:
+                return rng.nextU128() & rng.nextU128();
+            case Strategy::kAnd3:
+                return rng.nextU128() & rng.nextU128() & rng.nextU128();
+            case Strategy::kAnd4:
+                return rng.nextU128() & rng.nextU128() & rng.nextU128() & rng.nextU128();
+            case Strategy::kAnd3OrAnd4:
+                return (rng.nextU128() & rng.nextU128() & rng.nextU128())
+                     | (rng.nextU128() & rng.nextU128() & rng.nextU128() & rng.nextU128());
+            case Strategy::kSparse: {
+                const auto bits = kSparseMinBits + static_cast<i32>(rng.nextU32(kSparseMaxBits - kSparseMinBits + 1));
+
+                u128 candidate{};
+
+                for (i32 i = 0; i < bits; ++i) {
+                    candidate |= u128{1} << rng.nextU32(128);
+                }
+
+                return candidate;
+            }
+            case Strategy::kHighBiased: {
+                const auto high = rng.nextU64() & rng.nextU64();
+                const auto low = rng.nextU64() & rng.nextU64() & rng.nextU64() & rng.nextU64();
+                return toU128(high, low);
+            }
+            default:
+                assert(false);
+                return 0;
+        }
+    }
+
+    struct Candidate {
+        u128 magic;
+        Strategy strategy;
+    };
+
+    // candidate sources are handed to the search drivers, which call record() once
+    // for every candidate drawn with the number of subsets it passed before
+    // colliding - 0 if prefiltered, or the subset count if it is a valid magic
+
+    // always draws from one strategy
+    class FixedSource {
+    public:
+        FixedSource(u64 seed, Strategy strategy) :
+                m_rng{seed}, m_strategy{strategy} {}
+
+        [[nodiscard]] Candidate next() {
+            return {generateCandidate(m_strategy, m_rng), m_strategy};
+        }
+
+        void record(const Candidate&, usize, usize) {}
+
+    private:
+        util::rng::Jsf64Rng m_rng;
+        Strategy m_strategy;
+    };
+
+    // masks another source's candidates down to a magic shape (see magic.h)
+    template <typename Source>
+    class ShapedSource {
+    public:
+        ShapedSource(Source& source, u128 mask) :
+                m_source{source}, m_mask{mask} {}
+
+        [[nodiscard]] Candidate next() {
+            auto candidate = m_source.next();
+            candidate.magic &= m_mask;
+            return candidate;
+        }
+
+        void record(const Candidate& candidate, usize passed, usize total) {
+            m_source.record(candidate, passed, total);
+        }
+
+    private:
+        Source& m_source;
+        u128 m_mask;
+    };
+
+    // ucb1 bandit over all strategies. valid magics are far too rare to learn
+    // from within a single (square, bits) search, so a candidate is instead
+    // rewarded based on the fraction of subsets it passed before colliding.
+    // arms are picked for whole blocks of candidates, rather than one at a time
+    class BanditSource {
+    public:
+        explicit BanditSource(u64 seed) :
+                m_rng{seed} {}
+
+        [[nodiscard]] Candidate next() {
+            if (m_blockRemaining == 0) {
+                m_current = selectArm();
+                m_blockRemaining = kBlockSize;
+            }
+
+            --m_blockRemaining;
+
+            return {generateCandidate(m_current, m_rng), m_current};
+        }
+
+        void record(const Candidate& candidate, usize passed, usize total) {
+            auto& arm = m_arms[static_cast<usize>(candidate.strategy)];
+
+            // heavily favour candidates that get most of the way through - a
+            // strategy's chance of producing a valid magic lives in that tail
+            const auto fraction = static_cast<f64>(passed) / static_cast<f64>(total);
+            const auto squared = fraction * fraction;
+
+            ++arm.pulls;
+            arm.reward += squared * squared;
+
+            ++m_totalPulls;
+        }
+
+    private:
+        static constexpr usize kBlockSize = 256;
+        static constexpr f64 kExploration = 2.0;
+
+        struct Arm {
+            usize pulls{};
+            f64 reward{};
+        };
+
+        util::rng::Jsf64Rng m_rng;
+
+        std::array<Arm, kStrategyCount> m_arms{};
+        usize m_totalPulls{};
+
+        Strategy m_current{};
+        usize m_blockRemaining{};
+
+        [[nodiscard]] Strategy selectArm() const {
+            usize best = 0;
+            f64 bestScore = -1.0;
+
+            const auto logPulls = std::log(static_cast<f64>(m_totalPulls) + 1.0);
+
+            for (usize i = 0; i < kStrategyCount; ++i) {
+                const auto& arm = m_arms[i];
+
+                // play every arm once before trusting the means
+                if (arm.pulls == 0) {
+                    return static_cast<Strategy>(i);
+                }
+
+                const auto pulls = static_cast<f64>(arm.pulls);
+                const auto score = arm.reward / pulls + std::sqrt(kExploration * logPulls / pulls);
+
+                if (score > bestScore) {
+                    best = i;
+                    bestScore = score;
+                }
+            }
+
+            return static_cast<Strategy>(best);
+        }
+    };
+} // namespace stoat::search
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace stoat::search {
+    // collision table for a single candidate magic. like LaneTables, a slot holds
+    // the epoch it was written in above the attack class, so clearing the table
+    // between candidates is just an epoch bump. the epoch gets every bit the class
+    // leaves free, so slots are only physically cleared every 2^16 candidates or more
+    template <typename Class>
+    class CollisionTable {
+    public:
+        // makes room for 2^bits slots and starts a fresh epoch. never shrinks, so
+        // the same storage is reused across squares and bit levels
+        void reset(i32 bits) {
+            const auto count = usize{1} << bits;
+
+            if (m_slots.size() < count) {
+                m_slots.resize(count);
+            }
+
+            nextEpoch();
+        }
+
+        void nextEpoch() {
+            if (++m_epoch > kMaxEpoch) {
+                std::ranges::fill(m_slots, 0);
+                m_epoch = 1;
+            }
+        }
+
+        // returns false if the slot already holds a different class this epoch
+        [[nodiscard]] bool insert(usize idx, Class cls) {
+            assert(idx < m_slots.size());
+
+            auto& slot = m_slots[idx];
+            const auto expected = (m_epoch << kClassBits) | cls;
+
+            if ((slot >> kClassBits) != m_epoch) {
+                slot = expected;
+                return true;
+            }
+
+            return slot == expected;
+        }
+
+    private:
+        static_assert(sizeof(Class) <= sizeof(u16));
+
+        static constexpr i32 kClassBits = sizeof(Class) * 8;
+        static constexpr u32 kMaxEpoch = (u32{1} << (32 - kClassBits)) - 1;
+
+        std::vector<u32> m_slots{};
+        u32 m_epoch{};
+    };
+} // namespace stoat::search
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "../types.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../core.h"
+#include "magic.h"
+
+namespace stoat::search {
+    struct CorpusMagic {
+        u128 magic;
+        MagicScheme scheme;
+    };
+
+    // reads the k<piece>Magics array out of a file in the format this tool writes,
+    // U128(high, low) per square in square order. stoat's own tables use the same
+    // layout, so a file may hold several pieces' arrays. each magic's scheme comes
+    // from the k<piece>BlackMagic flag, a bool or one per square, with black
+    // assumed if there is none as in stoat's tables. returns one magic per square,
+    // or nothing if the file or array is missing or malformed
+    [[nodiscard]] inline std::vector<CorpusMagic> loadMagicCorpus(std::string_view path, std::string_view piece) {
+        std::ifstream stream{std::string{path}, std::ios::binary};
+
+        if (!stream) {
+            std::cerr << "failed to open magic corpus " << path << std::endl;
+            return {};
+        }
+
+        std::stringstream buffer{};
+        buffer << stream.rdbuf();
+
+        const auto contents = buffer.str();
+
+        const auto name = "k" + std::string{piece} + "Magics";
+        auto pos = contents.find(name);
+
+        if (pos == std::string::npos) {
+            std::cerr << "no " << name << " array in magic corpus " << path << std::endl;
+            return {};
+        }
+
+        const auto end = contents.find("};", pos);
+
+        std::vector<CorpusMagic> magics{};
+        magics.reserve(Squares::kCount);
+
+        while (magics.size() < Squares::kCount) {
+            pos = contents.find("U128(", pos);
+
+            if (pos == std::string::npos || pos > end) {
+                break;
+            }
+
+            const char* curr = contents.c_str() + pos + 5;
+            char* next{};
+
+            const u64 high = std::strtoull(curr, &next, 0);
+
+            while (*next == ',' || *next == ' ') {
+                ++next;
+            }
+
+            const u64 low = std::strtoull(next, &next, 0);
+
+            magics.push_back({toU128(high, low), MagicScheme::kBlack});
+            pos = next - contents.c_str();
+        }
+
+        if (magics.size() != Squares::kCount) {
+            std::cerr << "expected " << Squares::kCount << " magics in " << name << ", found " << magics.size()
+                      << std::endl;
+            return {};
+        }
+
+        const auto flagName = "k" + std::string{piece} + "BlackMagic";
+        pos = contents.find(flagName);
+
+        if (pos == std::string::npos) {
+            return magics;
+        }
+
+        const auto equals = contents.find('=', pos);
+        pos = equals == std::string::npos ? equals : contents.find_first_not_of(' ', equals + 1);
+
+        const bool perSquare = pos != std::string::npos && contents[pos] == '{';
+        pos = contents.find_first_of("tf", pos);
+
+        for (auto& magic : magics) {
+            if (pos == std::string::npos) {
+                std::cerr << "malformed " << flagName << " in magic corpus " << path << std::endl;
+                return {};
+            }
+
+            magic.scheme = contents.compare(pos, 4, "true") == 0 ? MagicScheme::kBlack : MagicScheme::kWhite;
+
+            if (perSquare) {
+                pos = contents.find_first_of("tf", contents.find(',', pos));
+            }
+        }
+
+        return magics;
+    }
+} // namespace stoat::search
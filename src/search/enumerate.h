@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <optional>
+
+#include "kernel.h"
+#include "prefilter.h"
+#include "scratch.h"
+#include "square_table.h"
+#include "stats.h"
+
+namespace stoat::search {
+    constexpr i32 kMaxEnumeratedSetBits = 12;
+
+    struct EnumerateParams {
+        // every magic with between 1 and this many set bits is tried
+        i32 maxSetBits;
+        // each (square, bits) enumeration is split into this many contiguous rank ranges
+        u32 partitions;
+    };
+
+    [[nodiscard]] constexpr u64 binomial(i32 n, i32 k) {
+        if (k < 0 || k > n) {
+            return 0;
+        }
+
+        u64 result = 1;
+
+        for (i32 i = 0; i < k; ++i) {
+            result = result * static_cast<u64>(n - i) / static_cast<u64>(i + 1);
+        }
+
+        return result;
+    }
+
+    // the number of magics an enumeration covers, i.e. its certificate's size
+    [[nodiscard]] constexpr u64 sparseMagicCount(i32 maxSetBits) {
+        u64 count{};
+
+        for (i32 setBits = 1; setBits <= maxSetBits; ++setBits) {
+            count += binomial(128, setBits);
+        }
+
+        return count;
+    }
+
+    // tries every magic in one partition of those with at most maxSetBits set bits.
+    // magics are ranked by set bit count, then in colex order of their bit positions
+    // within a count, and partition p covers ranks [p * n / partitions, (p + 1) * n /
+    // partitions). the prefilter must only apply necessary conditions, so that
+    // finding nothing in every partition proves no such magic exists
+    template <OccupancyOrder kOrder, typename Class>
+    [[nodiscard]] std::optional<u128> enumerate(
+        const SquareTable& table,
+        i32 bits,
+        const EnumerateParams& params,
+        u32 partition,
+        const Prefilter& prefilter,
+        Scratch& scratch,
+        Stats& stats
+    ) {
+        assert(params.maxSetBits <= kMaxEnumeratedSetBits);
+        assert(prefilter.minSpread == 0);
+
+        const auto shift = 128 - bits;
+
+        auto& used = scratch.table<Class>();
+        used.reset(bits);
+
+        scratch.order.reset(table);
+
+        const auto total = sparseMagicCount(params.maxSetBits);
+
+        // 128-bit intermediate, total * partitions can exceed 64 bits
+        const auto rangeStart = static_cast<u64>(u128{total} * partition / params.partitions);
+        const auto rangeEnd = static_cast<u64>(u128{total} * (partition + 1) / params.partitions);
+
+        // first rank of the current set bit count
+        u64 countStart = 0;
+
+        for (i32 setBits = 1; setBits <= params.maxSetBits; ++setBits) {
+            const auto countEnd = countStart + binomial(128, setBits);
+
+            const auto start = std::max(rangeStart, countStart);
+            const auto end = std::min(rangeEnd, countEnd);
+
+            if (start < end) {
+                // with a sentinel past the last position, and one more that stepping
+                // past the last combination of this count may touch
+                std::array<i32, kMaxEnumeratedSetBits + 2> positions{};
+
+                // unrank: the largest position p with C(p, i + 1) <= the remaining rank
+                // is the (i + 1)th smallest position
+                auto rank = start - countStart;
+
+                for (i32 i = setBits - 1; i >= 0; --i) {
+                    i32 pos = i;
+
+                    while (pos + 1 < 128 && binomial(pos + 1, i + 1) <= rank) {
+                        ++pos;
+                    }
+
+                    positions[i] = pos;
+                    rank -= binomial(pos, i + 1);
+                }
+
+                positions[setBits] = 128;
+
+                for (auto curr = start; curr < end; ++curr) {
+                    u128 magic{};
+
+                    for (i32 i = 0; i < setBits; ++i) {
+                        magic |= u128{1} << positions[i];
+                    }
+
+                    ++stats.candidates;
+
+                    if (!prefilter.accepts(table, magic, bits)) {
+                        ++stats.prefiltered;
+                    } else {
+                        const auto pos = testMagic<kOrder, Class>(table, magic, shift, scratch);
+                        used.nextEpoch();
+
+                        if (pos == table.size()) {
+                            return magic;
+                        }
+
+                        ++stats.rejected;
+                        stats.rejectedSubsets += pos + 1;
+                    }
+
+                    // next combination in colex order
+                    i32 i = 0;
+
+                    while (positions[i] + 1 == positions[i + 1]) {
+                        positions[i] = i;
+                        ++i;
+                    }
+
+                    ++positions[i];
+                }
+            }
+
+            countStart = countEnd;
+        }
+
+        return {};
+    }
+} // namespace stoat::search
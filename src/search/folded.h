@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "../types.h"
+
+#include <optional>
+#include <span>
+
+#include "../util/rng.h"
+#include "collision_table.h"
+#include "scratch.h"
+#include "square_table.h"
+#include "stats.h"
+
+namespace stoat::search {
+    // an alternative index scheme: the 81-bit occupancy is folded into 64 bits
+    // first, so that the index needs a single 64x64 multiply. squares 64 to 80
+    // are xored in at bits 47 to 63, which no mask also uses - squares 17 apart
+    // are never on one line - so the fold is injective on every square's mask
+    constexpr i32 kFoldShift = 47;
+
+    [[nodiscard]] constexpr u64 foldOccupancy(u128 occ) {
+        const auto [high, low] = fromU128(occ);
+        return low ^ (high << kFoldShift);
+    }
+
+    // shift is 64 - bits here
+    [[nodiscard]] constexpr usize getFoldedIdx(u128 occ, u64 magic, i32 shift) {
+        return static_cast<usize>((foldOccupancy(occ) * magic) >> shift);
+    }
+
+    // runtime lookup into an attack table laid out like the pext tables
+    struct FoldedSquare {
+        u128 mask;
+        u64 magic;
+        i32 shift;
+        usize offset;
+
+        [[nodiscard]] usize index(u128 occ) const {
+            return offset + getFoldedIdx(occ & mask, magic, shift);
+        }
+    };
+
+    // the fold is linear, so it is injective on a square's subsets exactly when
+    // the mask's bits fold to distinct bits. if not, two subsets with different
+    // attacks may share a key, and no magic could separate them
+    [[nodiscard]] inline bool foldable(const SquareTable& table) {
+        u64 folded{};
+
+        for (i32 i = 0; i < table.maskBits; ++i) {
+            const auto bit = foldOccupancy(u128{1} << table.bitPositions[i]);
+
+            if (folded & bit) {
+                return false;
+            }
+
+            folded |= bit;
+        }
+
+        return true;
+    }
+
+    template <typename Class>
+    [[nodiscard]] usize testFoldedMagic(
+        const SquareTable& table,
+        std::span<const u32> order,
+        u64 magic,
+        i32 shift,
+        CollisionTable<Class>& used
+    ) {
+        for (usize pos = 0; pos < order.size(); ++pos) {
+            const auto occIdx = order[pos];
+            const auto idx = getFoldedIdx(table.occupancies[occIdx], magic, shift);
+
+            if (!used.insert(idx, static_cast<Class>(table.classes[occIdx]))) {
+                return pos;
+            }
+        }
+
+        return order.size();
+    }
+
+    // random and3 candidates in the learned fail-fast order, like searchScalar
+    template <typename Class>
+    [[nodiscard]] std::optional<u64> searchFolded(
+        const SquareTable& table,
+        i32 bits,
+        usize attempts,
+        Scratch& scratch,
+        Stats& stats,
+        util::rng::Jsf64Rng& rng
+    ) {
+        const auto shift = 64 - bits;
+
+        auto& used = scratch.table<Class>();
+        used.reset(bits);
+
+        scratch.order.reset(table);
+
+        for (usize i = 0; i < attempts; ++i) {
+            const auto magic = rng.nextU64() & rng.nextU64() & rng.nextU64();
+
+            ++stats.candidates;
+
+            const auto pos = testFoldedMagic(table, scratch.order.order(), magic, shift, used);
+            used.nextEpoch();
+
+            if (pos == table.size()) {
+                return magic;
+            }
+
+            scratch.order.moveToFront(pos);
+
+            ++stats.rejected;
+            stats.rejectedSubsets += pos + 1;
+        }
+
+        return {};
+    }
+} // namespace stoat::search
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "../util/rng.h"
+#include "candidates.h"
+#include "kernel.h"
+#include "scratch.h"
+#include "square_table.h"
+#include "stats.h"
+
+namespace stoat::search {
+    struct GeneticParams {
+        // generations bred for one (square, bits) search
+        usize generations;
+        // individuals kept between generations, and children bred per generation
+        usize populationSize;
+        // individuals drawn per parent selection, the fittest of them breeding
+        usize tournamentSize;
+        // each child has between 1 and this many random bits flipped
+        u32 mutationBits;
+    };
+
+    // (mu + lambda) evolution of a pool of low-collision candidates. each generation
+    // breeds as many children as there are parents by uniform crossover and bit-flip
+    // mutation, then keeps the fittest distinct individuals of both. seeds (known magics,
+    // usually valid at a larger table size) and mutations of them start the pool, with
+    // random candidates filling the remainder
+    template <typename Class>
+    [[nodiscard]] std::optional<u128> evolve(
+        const SquareTable& table,
+        i32 bits,
+        const GeneticParams& params,
+        std::span<const u128> seeds,
+        Scratch& scratch,
+        Stats& stats,
+        util::rng::Jsf64Rng& rng
+    ) {
+        struct Individual {
+            u128 magic;
+            usize collisions;
+        };
+
+        const auto shift = 128 - bits;
+
+        auto& used = scratch.table<Class>();
+        used.reset(bits);
+
+        const auto evaluate = [&](u128 magic, usize limit) {
+            ++stats.candidates;
+
+            const auto collisions = countCollisions(table, magic, shift, used, limit);
+            used.nextEpoch();
+
+            return collisions;
+        };
+
+        const auto mutate = [&](u128 magic) {
+            const auto flips = 1 + rng.nextU32(params.mutationBits);
+
+            for (u32 i = 0; i < flips; ++i) {
+                magic ^= u128{1} << rng.nextU32(128);
+            }
+
+            return magic;
+        };
+
+        const auto select = [&](const std::vector<Individual>& population) {
+            const auto size = static_cast<u32>(population.size());
+
+            auto best = rng.nextU32(size);
+
+            for (usize i = 1; i < params.tournamentSize; ++i) {
+                best = std::min(best, rng.nextU32(size));
+            }
+
+            // the population is kept sorted, so the lowest index is the fittest
+            return population[best].magic;
+        };
+
+        std::vector<Individual> population{};
+        population.reserve(params.populationSize * 2);
+
+        for (usize i = 0; i < params.populationSize; ++i) {
+            u128 magic;
+
+            if (i < seeds.size()) {
+                magic = seeds[i];
+            } else if (!seeds.empty() && i < params.populationSize / 2) {
+                magic = mutate(seeds[i % seeds.size()]);
+            } else {
+                magic = generateCandidate(Strategy::kAnd3, rng);
+            }
+
+            const auto collisions = evaluate(magic, table.size());
+
+            if (collisions == 0) {
+                return magic;
+            }
+
+            population.push_back({magic, collisions});
+        }
+
+        const auto byFitness = [](const Individual& a, const Individual& b) {
+            return a.collisions < b.collisions || (a.collisions == b.collisions && a.magic < b.magic);
+        };
+
+        std::ranges::sort(population, byFitness);
+
+        for (usize generation = 0; generation < params.generations; ++generation) {
+            ++stats.generations;
+
+            // children no fitter than the current worst parent cannot survive,
+            // so stop counting their collisions there
+            const auto limit = population.back().collisions;
+
+            for (usize i = 0; i < params.populationSize; ++i) {
+                const auto a = select(population);
+                const auto b = select(population);
+
+                const auto crossover = rng.nextU128();
+                const auto child = mutate((a & crossover) | (b & ~crossover));
+
+                const auto collisions = evaluate(child, limit);
+
+                if (collisions == 0) {
+                    return child;
+                }
+
+                if (collisions <= limit) {
+                    population.push_back({child, collisions});
+                }
+            }
+
+            std::ranges::sort(population, byFitness);
+
+            // duplicates would let one individual take over the pool
+            const auto [first, last] = std::ranges::unique(population, {}, &Individual::magic);
+            population.erase(first, last);
+
+            if (population.size() > params.populationSize) {
+                population.resize(params.populationSize);
+            }
+        }
+
+        return {};
+    }
+} // namespace stoat::search
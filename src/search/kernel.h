@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <cassert>
+#include <span>
+#include <type_traits>
+
+#include "magic.h"
+#include "scratch.h"
+#include "square_table.h"
+
+namespace stoat::search {
+    enum class OccupancyOrder {
+        // carry-rippler order, starting from the empty set
+        kRippler,
+        // gray code order, updating the magic product incrementally
+        // rather than multiplying for every subset
+        kGray,
+        // the square's fail-fast order, refined as the search runs by moving
+        // subsets that reject candidates to the front
+        kFailFast,
+    };
+
+    // calls f with a std::integral_constant holding the table's mask size, so
+    // kernels can be instantiated for a fixed subset count
+    template <i32 kMaskBits = 1>
+    decltype(auto) withMaskBits(const SquareTable& table, auto&& f) {
+        if constexpr (kMaskBits == kMaxMaskBits) {
+            assert(table.maskBits == kMaskBits);
+            return f(std::integral_constant<i32, kMaskBits>{});
+        } else {
+            if (table.maskBits == kMaskBits) {
+                return f(std::integral_constant<i32, kMaskBits>{});
+            }
+
+            return withMaskBits<kMaskBits + 1>(table, f);
+        }
+    }
+
+    // a view of a square's first kSubsets values, with a compile-time extent when
+    // kSubsets is known so the walks over it have constant trip counts
+    template <usize kSubsets, typename T>
+    [[nodiscard]] constexpr std::span<const T, kSubsets> subsetView(std::span<const T> values) {
+        if constexpr (kSubsets == std::dynamic_extent) {
+            return values;
+        } else {
+            assert(values.size() == kSubsets);
+            return values.template first<kSubsets>();
+        }
+    }
+
+    // tables are far smaller than 2^64 entries, so the index always lies in the
+    // product's high word, and a 64-bit shift of that does for a 128-bit one
+    [[nodiscard]] constexpr usize productIdx(u128 product, i32 shift) {
+        assert(shift >= 64);
+        return static_cast<usize>(static_cast<u64>(product >> 64) >> (shift - 64));
+    }
+
+    // all kernels return the position in their walk of the first subset
+    // that collides, or the number of subsets if the magic is valid. kSubsets
+    // fixes the square's subset count at compile time, see withMaskBits
+
+    template <typename Class, usize kSubsets = std::dynamic_extent>
+    [[nodiscard]] usize testMagicRippler(
+        const SquareTable& table,
+        u128 magic,
+        i32 shift,
+        CollisionTable<Class>& used
+    ) {
+        const auto occupancies = subsetView<kSubsets>(table.occupancies);
+        const auto classes = subsetView<kSubsets>(table.classes);
+
+        for (usize occIdx = 0; occIdx < occupancies.size(); ++occIdx) {
+            const auto idx = productIdx(getKey(table.keyBits, occupancies[occIdx]) * magic, shift);
+
+            if (!used.insert(idx, static_cast<Class>(classes[occIdx]))) {
+                return occIdx;
+            }
+        }
+
+        return occupancies.size();
+    }
+
+    // consecutive gray codes differ in exactly one bit, and setting or clearing
+    // a mask bit adds or subtracts exactly that bit from the key (for both black
+    // and white magics), so multiplication distributing over addition means the
+    // product only ever changes by the magic shifted left by that bit's square
+    template <typename Class, usize kSubsets = std::dynamic_extent>
+    [[nodiscard]] usize testMagicGray(const SquareTable& table, u128 magic, i32 shift, CollisionTable<Class>& used) {
+        const auto grayClasses = subsetView<kSubsets>(table.grayClasses);
+        const auto graySteps = subsetView<kSubsets>(table.graySteps);
+
+        auto product = getKey(table.keyBits, 0) * magic;
+
+        for (usize i = 0;;) {
+            const auto idx = productIdx(product, shift);
+
+            if (!used.insert(idx, static_cast<Class>(grayClasses[i]))) {
+                return i;
+            }
+
+            if (++i == grayClasses.size()) {
+                break;
+            }
+
+            const auto step = graySteps[i];
+            const auto delta = magic << (step & ~kGrayStepClear);
+
+            if (step & kGrayStepClear) {
+                product -= delta;
+            } else {
+                product += delta;
+            }
+        }
+
+        return grayClasses.size();
+    }
+
+    template <typename Class, usize kSubsets = std::dynamic_extent>
+    [[nodiscard]] usize testMagicOrdered(
+        const SquareTable& table,
+        std::span<const u32, kSubsets> order,
+        u128 magic,
+        i32 shift,
+        CollisionTable<Class>& used
+    ) {
+        for (usize pos = 0; pos < order.size(); ++pos) {
+            const auto occIdx = order[pos];
+            const auto idx = productIdx(getKey(table.keyBits, table.occupancies[occIdx]) * magic, shift);
+
+            if (!used.insert(idx, static_cast<Class>(table.classes[occIdx]))) {
+                return pos;
+            }
+        }
+
+        return order.size();
+    }
+
+    // counts the subsets whose slot is already held by a different attack class,
+    // the first subset to reach a slot claiming it. gives up once the count
+    // exceeds limit, returning limit + 1. does not start a new epoch afterwards
+    template <typename Class>
+    [[nodiscard]] usize countCollisions(
+        const SquareTable& table,
+        u128 magic,
+        i32 shift,
+        CollisionTable<Class>& used,
+        usize limit
+    ) {
+        usize collisions = 0;
+
+        for (usize occIdx = 0; occIdx < table.size(); ++occIdx) {
+            const auto idx = productIdx(getKey(table.keyBits, table.occupancies[occIdx]) * magic, shift);
+
+            if (!used.insert(idx, static_cast<Class>(table.classes[occIdx])) && ++collisions > limit) {
+                break;
+            }
+        }
+
+        return collisions;
+    }
+
+    // expects scratch.table<Class>() and, for the fail-fast walk, scratch.order to
+    // have been reset for this square. does not start a new epoch afterwards
+    template <OccupancyOrder kOrder, typename Class, usize kSubsets = std::dynamic_extent>
+    [[nodiscard]] usize testMagic(const SquareTable& table, u128 magic, i32 shift, Scratch& scratch) {
+        auto& used = scratch.table<Class>();
+
+        if constexpr (kOrder == OccupancyOrder::kRippler) {
+            return testMagicRippler<Class, kSubsets>(table, magic, shift, used);
+        } else if constexpr (kOrder == OccupancyOrder::kGray) {
+            return testMagicGray<Class, kSubsets>(table, magic, shift, used);
+        } else {
+            static_assert(kOrder == OccupancyOrder::kFailFast);
+
+            const auto order = subsetView<kSubsets>(scratch.order.order());
+            const auto pos = testMagicOrdered<Class, kSubsets>(table, order, magic, shift, used);
+
+            if (pos < table.size()) {
+                scratch.order.moveToFront(pos);
+            }
+
+            return pos;
+        }
+    }
+} // namespace stoat::search
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <string_view>
+
+namespace stoat::search {
+    enum class MagicScheme : u8 {
+        // key = occ | ~mask, the full complement of the mask in all 128 bits
+        kBlack,
+        // key = occ
+        kWhite,
+    };
+
+    constexpr usize kSchemeCount = 2;
+
+    [[nodiscard]] constexpr std::string_view schemeName(MagicScheme scheme) {
+        return scheme == MagicScheme::kBlack ? "black" : "white";
+    }
+
+    // the bits or'd into every occupancy to form its key. the occupancy is
+    // always a subset of the mask, so this is also what key - occ comes to
+    [[nodiscard]] constexpr u128 keyBits(MagicScheme scheme, u128 mask) {
+        return scheme == MagicScheme::kBlack ? ~mask : 0;
+    }
+
+    // restrictions on a magic's bits that make the lookup's multiply cheaper. the
+    // index only needs the top word of key * magic, which costs three 64-bit
+    // multiplies in general
+    enum class MagicShape {
+        kFull,
+        // zero high word. key.low * magic (one widening multiply) plus
+        // key.high * magic (one truncating multiply) shifted up a word
+        kLow64,
+        // zero low word. only key.low * magic.high reaches the top word, one
+        // truncating multiply, but occupancies differing only in key.high collide
+        kHigh64,
+    };
+
+    [[nodiscard]] constexpr u128 shapeMask(MagicShape shape) {
+        switch (shape) {
+            case MagicShape::kLow64:
+                return toU128(0, ~u64{});
+            case MagicShape::kHigh64:
+                return toU128(~u64{}, 0);
+            default:
+                return ~u128{};
+        }
+    }
+
+    [[nodiscard]] constexpr std::string_view shapeName(MagicShape shape) {
+        switch (shape) {
+            case MagicShape::kLow64:
+                return "low 64-bit";
+            case MagicShape::kHigh64:
+                return "high 64-bit";
+            default:
+                return "full 128-bit";
+        }
+    }
+
+    struct Magic {
+        u128 magic;
+        i32 shift;
+        MagicScheme scheme;
+    };
+
+    [[nodiscard]] constexpr u128 getKey(u128 keyBits, u128 occ) {
+        return occ | keyBits;
+    }
+
+    [[nodiscard]] constexpr usize getIdx(u128 keyBits, u128 occ, u128 magic, i32 shift) {
+        return static_cast<usize>((getKey(keyBits, occ) * magic) >> shift);
+    }
+} // namespace stoat::search
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <cassert>
+#include <span>
+#include <vector>
+
+#include "square_table.h"
+
+namespace stoat::search {
+    // per-thread subset order for the fail-fast walk. starts out as the square's
+    // static fail-fast order, then every subset that rejects a candidate is moved
+    // to the front, so subsets that keep colliding get tested first
+    class LearnedOrder {
+    public:
+        void reset(const SquareTable& table) {
+            m_order.assign(table.failFastOrder.begin(), table.failFastOrder.end());
+        }
+
+        [[nodiscard]] std::span<const u32> order() const {
+            return m_order;
+        }
+
+        void moveToFront(usize pos) {
+            assert(pos < m_order.size());
+
+            const auto itr = m_order.begin() + static_cast<std::ptrdiff_t>(pos);
+            std::rotate(m_order.begin(), itr, itr + 1);
+        }
+
+    private:
+        std::vector<u32> m_order{};
+    };
+} // namespace stoat::search
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "../bitboard.h"
+#include "magic.h"
+#include "square_table.h"
+
+namespace stoat::search {
+    // a square's attack table as (index, attacks) pairs, one per slot its magic uses
+    using SlotList = std::vector<std::pair<usize, Bitboard>>;
+
+    [[nodiscard]] inline SlotList slotList(const SquareTable& table, const Magic& magic) {
+        std::vector<bool> seen(usize{1} << (128 - magic.shift));
+
+        SlotList slots{};
+
+        for (usize occIdx = 0; occIdx < table.size(); ++occIdx) {
+            const auto idx =
+                getIdx(keyBits(magic.scheme, table.mask), table.occupancies[occIdx], magic.magic, magic.shift);
+
+            if (!seen[idx]) {
+                seen[idx] = true;
+                slots.emplace_back(idx, table.attacks(occIdx));
+            }
+        }
+
+        return slots;
+    }
+
+    // packs attack tables into one array, first fit. a table may overlap those
+    // already placed wherever its slots land on unused entries, or on entries
+    // holding the same attacks. placing tables largest first packs best
+    class TablePacker {
+    public:
+        // returns the offset the table was placed at
+        usize place(std::span<const std::pair<usize, Bitboard>> slots) {
+            if (slots.empty()) {
+                return 0;
+            }
+
+            usize span{};
+
+            for (const auto& [idx, attacks] : slots) {
+                span = std::max(span, idx + 1);
+            }
+
+            const auto fits = [&](usize offset) {
+                for (const auto& [idx, attacks] : slots) {
+                    const auto pos = offset + idx;
+
+                    if (pos >= m_used.size()) {
+                        continue;
+                    }
+
+                    if (m_used[pos] && m_attacks[pos] != attacks) {
+                        return false;
+                    }
+                }
+
+                return true;
+            };
+
+            usize offset = 0;
+
+            while (!fits(offset)) {
+                ++offset;
+            }
+
+            if (offset + span > m_used.size()) {
+                m_used.resize(offset + span);
+                m_attacks.resize(offset + span);
+            }
+
+            for (const auto& [idx, attacks] : slots) {
+                m_used[offset + idx] = true;
+                m_attacks[offset + idx] = attacks;
+            }
+
+            return offset;
+        }
+
+        [[nodiscard]] usize size() const {
+            return m_used.size();
+        }
+
+    private:
+        std::vector<bool> m_used{};
+        std::vector<Bitboard> m_attacks{};
+    };
+} // namespace stoat::search
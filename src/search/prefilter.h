@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include "../util/bits.h"
+#include "magic.h"
+#include "square_table.h"
+
+namespace stoat::search {
+    // cheap checks run on each candidate before any collision table work
+    struct Prefilter {
+        // the classic chess magic check, adapted to u128: reject a candidate if fewer
+        // than minSpread eighths of the top bits of mask * magic are set. for black
+        // magics the ~mask part of the key only adds a constant to every product, so
+        // the spread of the mask alone is what matters there too. this is only a
+        // heuristic, and can reject valid magics. 0 disables it
+        i32 minSpread{};
+
+        // reject a candidate if it maps the empty occupancy and any single blocker
+        // that changes the attacks to the same index. this is a necessary condition,
+        // so it never rejects a valid magic
+        bool singleBlockers{};
+
+        [[nodiscard]] bool enabled() const {
+            return minSpread > 0 || singleBlockers;
+        }
+
+        [[nodiscard]] bool accepts(const SquareTable& table, u128 magic, i32 bits) const {
+            const auto shift = 128 - bits;
+
+            if (minSpread > 0) {
+                const auto spread = util::popcount((table.mask * magic) >> shift);
+
+                if (spread * 8 < minSpread * bits) {
+                    return false;
+                }
+            }
+
+            if (singleBlockers) {
+                const auto product = getKey(table.keyBits, 0) * magic;
+                const auto emptyIdx = product >> shift;
+
+                for (i32 i = 0; i < table.singleBlockerCount; ++i) {
+                    const auto delta = magic << table.singleBlockers[i];
+
+                    if (((product + delta) >> shift) == emptyIdx) {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+    };
+} // namespace stoat::search
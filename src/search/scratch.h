@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <type_traits>
+
+#include "collision_table.h"
+#include "order.h"
+#include "simd.h"
+
+namespace stoat::search {
+    // per-thread working memory, kept alive for a thread's whole lifetime
+    struct Scratch {
+        CollisionTable<u8> smallTable{};
+        CollisionTable<u16> largeTable{};
+
+        simd::LaneTables laneTables{};
+
+        LearnedOrder order{};
+
+        template <typename Class>
+        [[nodiscard]] CollisionTable<Class>& table() {
+            if constexpr (std::is_same_v<Class, u8>) {
+                return smallTable;
+            } else {
+                static_assert(std::is_same_v<Class, u16>);
+                return largeTable;
+            }
+        }
+    };
+} // namespace stoat::search
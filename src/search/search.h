@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <tuple>
+
+#include "candidates.h"
+#include "kernel.h"
+#include "prefilter.h"
+#include "scratch.h"
+#include "simd.h"
+#include "square_table.h"
+#include "stats.h"
+
+namespace stoat::search {
+    // both drivers draw up to `attempts` candidates from a candidate source (see
+    // candidates.h), and call onValid with each valid magic in draw order until
+    // it returns true. they reset the collision tables in scratch themselves, but
+    // scratch.order is left to the caller, so that what it learned carries over
+    // between calls searching the same square in chunks
+
+    // kSubsets fixes the square's subset count at compile time, see withMaskBits
+    template <OccupancyOrder kOrder, typename Class, usize kSubsets = std::dynamic_extent>
+    void searchScalar(
+        const SquareTable& table,
+        i32 bits,
+        usize attempts,
+        const Prefilter& prefilter,
+        Scratch& scratch,
+        Stats& stats,
+        auto& source,
+        auto&& onValid
+    ) {
+        const auto shift = 128 - bits;
+
+        auto& used = scratch.table<Class>();
+        used.reset(bits);
+
+        for (usize i = 0; i < attempts; ++i) {
+            const Candidate candidate = source.next();
+            const auto strategy = static_cast<usize>(candidate.strategy);
+
+            ++stats.candidates;
+            ++stats.strategyCandidates[strategy];
+
+            if (!prefilter.accepts(table, candidate.magic, bits)) {
+                ++stats.prefiltered;
+                source.record(candidate, 0, table.size());
+                continue;
+            }
+
+            const auto pos = testMagic<kOrder, Class, kSubsets>(table, candidate.magic, shift, scratch);
+
+            source.record(candidate, pos, table.size());
+
+            if (pos == table.size()) {
+                ++stats.strategyHits[strategy];
+
+                if (onValid(candidate.magic)) {
+                    return;
+                }
+            } else {
+                ++stats.rejected;
+                stats.rejectedSubsets += pos + 1;
+            }
+
+            used.nextEpoch();
+        }
+    }
+
+    // always walks in the learned fail-fast order
+    void searchSimd(
+        const SquareTable& table,
+        i32 bits,
+        usize attempts,
+        const Prefilter& prefilter,
+        Scratch& scratch,
+        Stats& stats,
+        auto& source,
+        auto&& onValid
+    ) {
+        const auto shift = 128 - bits;
+
+        auto& used = scratch.laneTables;
+        used.reset(bits);
+
+        simd::LaneMagics magics{};
+        std::array<Candidate, simd::kLanes> candidates{};
+        std::array<usize, simd::kLanes> failPos{};
+
+        usize drawn = 0;
+
+        while (drawn < attempts) {
+            u32 lanes = 0;
+            usize filled = 0;
+
+            while (filled < simd::kLanes && drawn < attempts) {
+                const Candidate candidate = source.next();
+
+                ++drawn;
+                ++stats.candidates;
+                ++stats.strategyCandidates[static_cast<usize>(candidate.strategy)];
+
+                if (!prefilter.accepts(table, candidate.magic, bits)) {
+                    ++stats.prefiltered;
+                    source.record(candidate, 0, table.size());
+                    continue;
+                }
+
+                candidates[filled] = candidate;
+                std::tie(magics.high[filled], magics.low[filled]) = fromU128(candidate.magic);
+
+                lanes |= 1U << filled;
+                ++filled;
+            }
+
+            if (lanes == 0) {
+                break;
+            }
+
+            const auto valid = simd::testMagics(table, scratch.order.order(), magics, lanes, shift, used, failPos);
+
+            for (auto remaining = valid; remaining != 0; remaining &= remaining - 1) {
+                const auto& candidate = candidates[std::countr_zero(remaining)];
+
+                source.record(candidate, table.size(), table.size());
+                ++stats.strategyHits[static_cast<usize>(candidate.strategy)];
+
+                if (onValid(candidate.magic)) {
+                    return;
+                }
+            }
+
+            // moving a subset to the front only shifts the ones before it,
+            // so learn from the earliest collision first
+            std::array<usize, simd::kLanes> collisions{};
+            usize collisionCount = 0;
+
+            for (auto remaining = lanes & ~valid; remaining != 0; remaining &= remaining - 1) {
+                const auto lane = std::countr_zero(remaining);
+                const auto pos = failPos[lane];
+
+                source.record(candidates[lane], pos, table.size());
+
+                ++stats.rejected;
+                stats.rejectedSubsets += pos + 1;
+
+                collisions[collisionCount++] = pos;
+            }
+
+            std::sort(collisions.begin(), collisions.begin() + collisionCount);
+            const auto end = std::unique(collisions.begin(), collisions.begin() + collisionCount);
+
+            for (auto itr = collisions.begin(); itr != end; ++itr) {
+                scratch.order.moveToFront(*itr);
+            }
+
+            used.nextEpoch();
+        }
+    }
+} // namespace stoat::search
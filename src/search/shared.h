@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "../types.h"
+
+#include <span>
+
+#include "kernel.h"
+#include "prefilter.h"
+#include "scratch.h"
+#include "square_table.h"
+
+namespace stoat::search {
+    // a square a shared magic may serve, at a fixed table size
+    struct SharedTarget {
+        const SquareTable* table;
+        i32 bits;
+    };
+
+    // walks the square's static fail-fast order - the learned order is per square,
+    // and a shared candidate moves between squares with every test
+    [[nodiscard]] inline bool validFor(
+        const SharedTarget& target,
+        u128 magic,
+        const Prefilter& prefilter,
+        Scratch& scratch
+    ) {
+        const auto& table = *target.table;
+
+        if (!prefilter.accepts(table, magic, target.bits)) {
+            return false;
+        }
+
+        return withClassType(table, [&]<typename Class>(Class) {
+            auto& used = scratch.table<Class>();
+            used.reset(target.bits);
+
+            return testMagicOrdered(table, table.failFastOrder, magic, 128 - target.bits, used) == table.size();
+        });
+    }
+
+    // a shared candidate's score is the number of still unserved squares it is valid for
+    [[nodiscard]] inline usize sharedScore(
+        std::span<const SharedTarget> targets,
+        std::span<const usize> pending,
+        u128 magic,
+        const Prefilter& prefilter,
+        Scratch& scratch
+    ) {
+        usize score{};
+
+        for (const auto targetIdx : pending) {
+            if (validFor(targets[targetIdx], magic, prefilter, scratch)) {
+                ++score;
+            }
+        }
+
+        return score;
+    }
+} // namespace stoat::search
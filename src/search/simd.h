@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <span>
+#include <vector>
+
+#include "../arch.h"
+#include "magic.h"
+#include "square_table.h"
+
+#if ST_HAS_AVX512 || ST_HAS_AVX2
+    #include <immintrin.h>
+#endif
+
+namespace stoat::search::simd {
+#if ST_HAS_AVX512
+    constexpr usize kLanes = 8;
+#else
+    constexpr usize kLanes = 4;
+#endif
+
+    constexpr bool kAvailable = ST_HAS_AVX512 || ST_HAS_AVX2;
+
+    // one candidate magic per lane, split into words
+    struct LaneMagics {
+        alignas(64) std::array<u64, kLanes> high;
+        alignas(64) std::array<u64, kLanes> low;
+    };
+
+    using LaneIndices = std::array<u64, kLanes>;
+
+    // computes (key * magic) >> shift for every lane's magic at once. shifts are
+    // always at least 64, so only the high word of each product is needed - that
+    // is the high half of keyLow * magicLow, plus the low halves of the cross terms
+    class LaneMultiplier {
+    public:
+        LaneMultiplier(const LaneMagics& magics, i32 shift) {
+            assert(shift >= 64 && shift < 128);
+
+#if ST_HAS_AVX512
+            m_magicHigh = _mm512_load_si512(magics.high.data());
+            m_magicLow = _mm512_load_si512(magics.low.data());
+            m_magicLowHalf = _mm512_srli_epi64(m_magicLow, 32);
+            m_shift = _mm_cvtsi32_si128(shift - 64);
+#elif ST_HAS_AVX2
+            m_magicHigh = _mm256_load_si256(reinterpret_cast<const __m256i*>(magics.high.data()));
+            m_magicLow = _mm256_load_si256(reinterpret_cast<const __m256i*>(magics.low.data()));
+            m_magicHighHalf = _mm256_srli_epi64(m_magicHigh, 32);
+            m_magicLowHalf = _mm256_srli_epi64(m_magicLow, 32);
+            m_shift = _mm_cvtsi32_si128(shift - 64);
+#else
+            for (usize lane = 0; lane < kLanes; ++lane) {
+                m_magics[lane] = toU128(magics.high[lane], magics.low[lane]);
+            }
+
+            m_shift = shift;
+#endif
+        }
+
+#if ST_HAS_AVX512
+        [[nodiscard]] __m512i indices(u128 key) const {
+            const auto [keyHigh, keyLow] = fromU128(key);
+
+            const auto lowMask = _mm512_set1_epi64(0xffffffff);
+
+            // 64x64 -> 128 has no vector instruction, so build the
+            // high half of keyLow * magicLow from 32x32 -> 64 products
+            const auto a0 = _mm512_set1_epi64(static_cast<i64>(keyLow & 0xffffffff));
+            const auto a1 = _mm512_set1_epi64(static_cast<i64>(keyLow >> 32));
+
+            const auto ll = _mm512_mul_epu32(a0, m_magicLow);
+            const auto hl = _mm512_mul_epu32(a1, m_magicLow);
+            const auto lh = _mm512_mul_epu32(a0, m_magicLowHalf);
+            const auto hh = _mm512_mul_epu32(a1, m_magicLowHalf);
+
+            auto mid = _mm512_srli_epi64(ll, 32);
+            mid = _mm512_add_epi64(mid, _mm512_and_si512(hl, lowMask));
+            mid = _mm512_add_epi64(mid, _mm512_and_si512(lh, lowMask));
+
+            auto high = _mm512_add_epi64(hh, _mm512_srli_epi64(mid, 32));
+            high = _mm512_add_epi64(high, _mm512_srli_epi64(hl, 32));
+            high = _mm512_add_epi64(high, _mm512_srli_epi64(lh, 32));
+
+            high = _mm512_add_epi64(high, _mm512_mullo_epi64(_mm512_set1_epi64(static_cast<i64>(keyLow)), m_magicHigh));
+            high = _mm512_add_epi64(high, _mm512_mullo_epi64(_mm512_set1_epi64(static_cast<i64>(keyHigh)), m_magicLow));
+
+            return _mm512_srl_epi64(high, m_shift);
+        }
+#else
+        void indices(u128 key, LaneIndices& dst) const {
+            const auto [keyHigh, keyLow] = fromU128(key);
+
+    #if ST_HAS_AVX2
+            const auto lowMask = _mm256_set1_epi64x(0xffffffff);
+
+            const auto a0 = _mm256_set1_epi64x(static_cast<i64>(keyLow & 0xffffffff));
+            const auto a1 = _mm256_set1_epi64x(static_cast<i64>(keyLow >> 32));
+
+            const auto ll = _mm256_mul_epu32(a0, m_magicLow);
+            const auto hl = _mm256_mul_epu32(a1, m_magicLow);
+            const auto lh = _mm256_mul_epu32(a0, m_magicLowHalf);
+            const auto hh = _mm256_mul_epu32(a1, m_magicLowHalf);
+
+            auto mid = _mm256_srli_epi64(ll, 32);
+            mid = _mm256_add_epi64(mid, _mm256_and_si256(hl, lowMask));
+            mid = _mm256_add_epi64(mid, _mm256_and_si256(lh, lowMask));
+
+            auto high = _mm256_add_epi64(hh, _mm256_srli_epi64(mid, 32));
+            high = _mm256_add_epi64(high, _mm256_srli_epi64(hl, 32));
+            high = _mm256_add_epi64(high, _mm256_srli_epi64(lh, 32));
+
+            // no vpmullq either, but only the low 32 bits of the products
+            // of mismatched halves survive the shift into the high half
+            const auto b0 = _mm256_set1_epi64x(static_cast<i64>(keyHigh & 0xffffffff));
+            const auto b1 = _mm256_set1_epi64x(static_cast<i64>(keyHigh >> 32));
+
+            auto cross = _mm256_add_epi64(_mm256_mul_epu32(a1, m_magicHigh), _mm256_mul_epu32(a0, m_magicHighHalf));
+            cross = _mm256_add_epi64(cross, _mm256_mul_epu32(b1, m_magicLow));
+            cross = _mm256_add_epi64(cross, _mm256_mul_epu32(b0, m_magicLowHalf));
+
+            high = _mm256_add_epi64(high, _mm256_slli_epi64(cross, 32));
+            high = _mm256_add_epi64(high, _mm256_mul_epu32(a0, m_magicHigh));
+            high = _mm256_add_epi64(high, _mm256_mul_epu32(b0, m_magicLow));
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst.data()), _mm256_srl_epi64(high, m_shift));
+    #else
+            for (usize lane = 0; lane < kLanes; ++lane) {
+                dst[lane] = static_cast<u64>((key * m_magics[lane]) >> m_shift);
+            }
+    #endif
+        }
+#endif
+
+    private:
+#if ST_HAS_AVX512
+        __m512i m_magicHigh;
+        __m512i m_magicLow;
+        __m512i m_magicLowHalf;
+        __m128i m_shift;
+#elif ST_HAS_AVX2
+        __m256i m_magicHigh;
+        __m256i m_magicLow;
+        __m256i m_magicHighHalf;
+        __m256i m_magicLowHalf;
+        __m128i m_shift;
+#else
+        std::array<u128, kLanes> m_magics;
+        i32 m_shift;
+#endif
+    };
+
+    // collision tables for every lane in one buffer, lane after lane. a slot holds
+    // the epoch it was written in above the attack class, and all lanes share one
+    // epoch - a batch of candidates is always started and finished together
+    class LaneTables {
+    public:
+        void reset(i32 bits) {
+            m_stride = usize{1} << bits;
+
+            if (m_slots.size() < m_stride * kLanes) {
+                m_slots.resize(m_stride * kLanes);
+            }
+
+            nextEpoch();
+        }
+
+        void nextEpoch() {
+            if (++m_epoch == 0) {
+                std::ranges::fill(m_slots, 0);
+                m_epoch = 1;
+            }
+        }
+
+        [[nodiscard]] u32 expected(AttackClass cls) const {
+            return (static_cast<u32>(m_epoch) << 16) | cls;
+        }
+
+        // returns false if the slot already holds a different class this epoch
+        [[nodiscard]] bool insert(usize lane, usize idx, AttackClass cls) {
+            assert(idx < m_stride);
+
+            auto& slot = m_slots[lane * m_stride + idx];
+
+            if ((slot >> 16) != m_epoch) {
+                slot = expected(cls);
+                return true;
+            }
+
+            return slot == expected(cls);
+        }
+
+        [[nodiscard]] u32* data() {
+            return m_slots.data();
+        }
+
+        [[nodiscard]] usize stride() const {
+            return m_stride;
+        }
+
+        [[nodiscard]] u16 epoch() const {
+            return m_epoch;
+        }
+
+    private:
+        std::vector<u32> m_slots{};
+        usize m_stride{};
+        u16 m_epoch{};
+    };
+
+    // walks the subsets in order for the magics in every lane set in `lanes` at
+    // once, each lane checking its own collision table, and drops lanes as they
+    // collide. failPos receives the walk position of each dropped lane's first
+    // collision. returns the lanes whose magics are valid
+    [[nodiscard]] inline u32 testMagics(
+        const SquareTable& table,
+        std::span<const u32> order,
+        const LaneMagics& magics,
+        u32 lanes,
+        i32 shift,
+        LaneTables& used,
+        std::array<usize, kLanes>& failPos
+    ) {
+        const LaneMultiplier multiplier{magics, shift};
+
+        auto alive = lanes;
+
+#if ST_HAS_AVX512
+        // gather every alive lane's slot, compare them all at once, then
+        // scatter the claimed ones back - lanes never share a slot
+        const auto base = used.data();
+        const auto offsets = _mm512_mullo_epi64(
+            _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0),
+            _mm512_set1_epi64(static_cast<i64>(used.stride()))
+        );
+
+        const auto epoch = _mm256_set1_epi32(used.epoch());
+
+        for (usize pos = 0; pos < order.size() && alive != 0; ++pos) {
+            const auto occIdx = order[pos];
+            const auto alive8 = static_cast<__mmask8>(alive);
+
+            const auto slotIdx =
+                _mm512_add_epi64(multiplier.indices(getKey(table.keyBits, table.occupancies[occIdx])), offsets);
+            const auto slots = _mm512_mask_i64gather_epi32(_mm256_setzero_si256(), alive8, slotIdx, base, 4);
+
+            const auto expected = _mm256_set1_epi32(static_cast<i32>(used.expected(table.classes[occIdx])));
+
+            const auto empty = _mm256_mask_cmpneq_epi32_mask(alive8, _mm256_srli_epi32(slots, 16), epoch);
+            const auto collided = _mm256_mask_cmpneq_epi32_mask(alive8 & ~empty, slots, expected);
+
+            _mm512_mask_i64scatter_epi32(base, empty, slotIdx, expected, 4);
+
+            for (u32 remaining = collided; remaining != 0; remaining &= remaining - 1) {
+                failPos[std::countr_zero(remaining)] = pos;
+            }
+
+            alive &= ~static_cast<u32>(collided);
+        }
+#else
+        LaneIndices indices;
+
+        for (usize pos = 0; pos < order.size() && alive != 0; ++pos) {
+            const auto occIdx = order[pos];
+            const auto cls = table.classes[occIdx];
+
+            multiplier.indices(getKey(table.keyBits, table.occupancies[occIdx]), indices);
+
+            for (auto remaining = alive; remaining != 0; remaining &= remaining - 1) {
+                const auto lane = std::countr_zero(remaining);
+
+                if (!used.insert(lane, indices[lane], cls)) {
+                    alive &= ~(1U << lane);
+                    failPos[lane] = pos;
+                }
+            }
+        }
+#endif
+
+        return alive;
+    }
+} // namespace stoat::search::simd
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "../bitboard.h"
+#include "magic.h"
+#include "square_table.h"
+
+namespace stoat::search {
+    // attack table entries are bitboards, several to a cache line
+    constexpr usize kEntriesPerCacheLine = 64 / sizeof(Bitboard);
+
+    enum class SpanObjective {
+        // smallest largest index, i.e. the smallest table
+        kMaxIndex,
+        // fewest distinct cache lines holding an entry
+        kCacheLines,
+    };
+
+    struct TableSpan {
+        usize maxIndex;
+        usize cacheLines;
+    };
+
+    // how much of its 2^bits slots a valid magic's table actually uses
+    [[nodiscard]] inline TableSpan tableSpan(const SquareTable& table, u128 magic, i32 shift) {
+        std::vector<bool> lines((usize{1} << (128 - shift)) / kEntriesPerCacheLine + 1);
+
+        TableSpan span{};
+
+        for (usize occIdx = 0; occIdx < table.size(); ++occIdx) {
+            const auto idx = getIdx(table.keyBits, table.occupancies[occIdx], magic, shift);
+            span.maxIndex = std::max(span.maxIndex, idx);
+
+            const auto line = idx / kEntriesPerCacheLine;
+
+            if (!lines[line]) {
+                lines[line] = true;
+                ++span.cacheLines;
+            }
+        }
+
+        return span;
+    }
+
+    // the other measure breaks ties
+    [[nodiscard]] constexpr bool smallerSpan(SpanObjective objective, const TableSpan& a, const TableSpan& b) {
+        if (objective == SpanObjective::kMaxIndex) {
+            return a.maxIndex < b.maxIndex || (a.maxIndex == b.maxIndex && a.cacheLines < b.cacheLines);
+        } else {
+            return a.cacheLines < b.cacheLines || (a.cacheLines == b.cacheLines && a.maxIndex < b.maxIndex);
+        }
+    }
+} // namespace stoat::search
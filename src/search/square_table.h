@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <limits>
+#include <map>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "../bitboard.h"
+#include "magic.h"
+
+namespace stoat::search {
+    // 7 + 7 for a rook, 13 would already cover every square on the board
+    constexpr i32 kMaxMaskBits = 16;
+
+    constexpr u8 kGrayStepClear = 0x80;
+
+    // distinct attack sets are numbered from 0 in order of first appearance
+    using AttackClass = u16;
+
+    // the per-subset arrays of a square table, owned separately so that copies
+    // of a table for each magic scheme share them
+    struct SquareStorage {
+        std::vector<u128> occupancies{};
+        std::vector<AttackClass> classes{};
+        std::vector<AttackClass> grayClasses{};
+        std::vector<u8> graySteps{};
+        std::vector<u32> failFastOrder{};
+        std::vector<Bitboard> classAttacks{};
+    };
+
+    // every subset of a square's mask along with the class of the attacks it
+    // produces, stored in carry-rippler order. built once per square before
+    // searching, then shared read-only between all search threads. copies
+    // are cheap, and differ only in the magic scheme they search for
+    struct SquareTable {
+        Square sq{Squares::kNone};
+        u128 mask{};
+        i32 maskBits{};
+
+        MagicScheme scheme{};
+        // or'd into every subset to form its key, see magic.h
+        u128 keyBits{};
+
+        // mask bits from lowest to highest, i.e. bit i of a subset's
+        // index in carry-rippler order corresponds to square bitPositions[i]
+        std::array<u8, kMaxMaskBits> bitPositions{};
+
+        std::shared_ptr<const SquareStorage> storage{};
+
+        std::span<const u128> occupancies{};
+        std::span<const AttackClass> classes{};
+
+        // classes reordered to follow a gray code walk over the subsets,
+        // entry i is the class of the subset at rippler index i ^ (i >> 1)
+        std::span<const AttackClass> grayClasses{};
+        // square toggled going from gray subset i - 1 to i, with kGrayStepClear
+        // set if that square is removed from the occupancy rather than added.
+        // entry 0 is unused
+        std::span<const u8> graySteps{};
+
+        // rippler indices of subsets, ordered so that those most likely to collide come first
+        std::span<const u32> failFastOrder{};
+
+        // squares that produce different attacks to the empty occupancy when they are
+        // the only blocker - in practice, the first mask square along each ray
+        std::array<u8, kMaxMaskBits> singleBlockers{};
+        i32 singleBlockerCount{};
+
+        std::span<const Bitboard> classAttacks{};
+
+        [[nodiscard]] usize size() const {
+            return occupancies.size();
+        }
+
+        [[nodiscard]] usize classCount() const {
+            return classAttacks.size();
+        }
+
+        // every attack class needs a slot of its own, so no magic for this
+        // square indexes fewer than ceil(log2(classes)) bits
+        [[nodiscard]] i32 minBits() const {
+            return std::max(static_cast<i32>(std::bit_width(classCount() - 1)), 1);
+        }
+
+        [[nodiscard]] Bitboard attacks(usize occIdx) const {
+            return classAttacks[classes[occIdx]];
+        }
+    };
+
+    // calls f with a value of the narrowest type that can hold all of a square's attack classes
+    decltype(auto) withClassType(const SquareTable& table, auto&& f) {
+        if (table.classCount() <= usize{std::numeric_limits<u8>::max()} + 1) {
+            return f(u8{});
+        } else {
+            return f(u16{});
+        }
+    }
+
+    // the same square searched for magics of another scheme
+    [[nodiscard]] inline SquareTable withScheme(const SquareTable& table, MagicScheme scheme) {
+        auto result = table;
+
+        result.scheme = scheme;
+        result.keyBits = keyBits(scheme, table.mask);
+
+        return result;
+    }
+
+    // tables are built for black magics, see withScheme
+    [[nodiscard]] SquareTable buildSquareTable(Square sq, Bitboard mask, const auto& attackGetter) {
+        assert(!mask.empty());
+
+        SquareTable table{};
+        SquareStorage storage{};
+
+        table.sq = sq;
+        table.mask = mask.raw();
+        table.maskBits = mask.popcount();
+
+        table.scheme = MagicScheme::kBlack;
+        table.keyBits = keyBits(table.scheme, table.mask);
+
+        assert(table.maskBits <= kMaxMaskBits);
+
+        auto remaining = mask;
+        for (i32 i = 0; i < table.maskBits; ++i) {
+            table.bitPositions[i] = remaining.popLsb().raw();
+        }
+
+        const auto count = usize{1} << table.maskBits;
+
+        storage.occupancies.reserve(count);
+        storage.classes.reserve(count);
+
+        std::map<u128, AttackClass> classIds{};
+
+        u128 occ = 0;
+        do {
+            const Bitboard attacks = attackGetter(sq, Bitboard{occ});
+            assert(!attacks.empty());
+
+            auto [itr, inserted] = classIds.try_emplace(attacks.raw(), storage.classAttacks.size());
+
+            if (inserted) {
+                assert(storage.classAttacks.size() < std::numeric_limits<AttackClass>::max());
+                storage.classAttacks.push_back(attacks);
+            }
+
+            storage.occupancies.push_back(occ);
+            storage.classes.push_back(itr->second);
+
+            occ = (occ - table.mask) & table.mask;
+        } while (occ != 0);
+
+        assert(storage.occupancies.size() == count);
+
+        storage.grayClasses.reserve(count);
+        storage.graySteps.reserve(count);
+
+        for (usize i = 0; i < count; ++i) {
+            const auto gray = i ^ (i >> 1);
+
+            storage.grayClasses.push_back(storage.classes[gray]);
+
+            if (i == 0) {
+                storage.graySteps.push_back(0);
+                continue;
+            }
+
+            const auto bit = std::countr_zero(i);
+            const bool clear = ((gray >> bit) & 1) == 0;
+
+            storage.graySteps.push_back(table.bitPositions[bit] | (clear ? kGrayStepClear : 0));
+        }
+
+        for (i32 bit = 0; bit < table.maskBits; ++bit) {
+            if (storage.classes[usize{1} << bit] != storage.classes[0]) {
+                table.singleBlockers[table.singleBlockerCount++] = table.bitPositions[bit];
+            }
+        }
+
+        // pairs of subsets one blocker apart with different attacks go first, each
+        // next to its partner - with a sparse magic, the products of two keys that
+        // differ in a single bit often agree in their top bits. every other subset
+        // follows in rippler order
+        std::vector<bool> placed(count);
+        storage.failFastOrder.reserve(count);
+
+        for (usize i = 0; i < count; ++i) {
+            if (placed[i]) {
+                continue;
+            }
+
+            for (i32 bit = 0; bit < table.maskBits; ++bit) {
+                const auto partner = i ^ (usize{1} << bit);
+
+                if (!placed[partner] && storage.classes[i] != storage.classes[partner]) {
+                    storage.failFastOrder.push_back(i);
+                    storage.failFastOrder.push_back(partner);
+
+                    placed[i] = true;
+                    placed[partner] = true;
+
+                    break;
+                }
+            }
+        }
+
+        for (usize i = 0; i < count; ++i) {
+            if (!placed[i]) {
+                storage.failFastOrder.push_back(i);
+            }
+        }
+
+        assert(storage.failFastOrder.size() == count);
+
+        table.storage = std::make_shared<const SquareStorage>(std::move(storage));
+
+        table.occupancies = table.storage->occupancies;
+        table.classes = table.storage->classes;
+        table.grayClasses = table.storage->grayClasses;
+        table.graySteps = table.storage->graySteps;
+        table.failFastOrder = table.storage->failFastOrder;
+        table.classAttacks = table.storage->classAttacks;
+
+        return table;
+    }
+} // namespace stoat::search
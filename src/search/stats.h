@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "../types.h"
+
+#include <array>
+
+#include "candidates.h"
+
+namespace stoat::search {
+    struct Stats {
+        usize candidates{};
+        // rejected by the prefilter, without walking any subsets
+        usize prefiltered{};
+        // rejected while walking subsets
+        usize rejected{};
+        // subsets walked by rejected candidates, including the one that collided
+        usize rejectedSubsets{};
+
+        // restarts from a fresh candidate by the annealing engine
+        usize annealRuns{};
+        // generations bred by the genetic engine
+        usize generations{};
+        // nodes visited and branches pruned by the backtracking engine, and searches
+        // that covered their whole subtree without finding a magic
+        usize backtrackNodes{};
+        usize backtrackPrunes{};
+        usize backtrackExhausted{};
+
+        // levels stopped early by an adaptive budget, and attempts they drew from
+        // the shared pool beyond their own budget
+        usize budgetStops{};
+        usize budgetBorrowed{};
+
+        std::array<usize, kStrategyCount> strategyCandidates{};
+        std::array<usize, kStrategyCount> strategyHits{};
+
+        void merge(const Stats& other) {
+            candidates += other.candidates;
+            prefiltered += other.prefiltered;
+            rejected += other.rejected;
+            rejectedSubsets += other.rejectedSubsets;
+            annealRuns += other.annealRuns;
+            generations += other.generations;
+            backtrackNodes += other.backtrackNodes;
+            backtrackPrunes += other.backtrackPrunes;
+            backtrackExhausted += other.backtrackExhausted;
+            budgetStops += other.budgetStops;
+            budgetBorrowed += other.budgetBorrowed;
+
+            for (usize i = 0; i < kStrategyCount; ++i) {
+                strategyCandidates[i] += other.strategyCandidates[i];
+                strategyHits[i] += other.strategyHits[i];
+            }
+        }
+
+        [[nodiscard]] f64 prefilterRate() const {
+            return candidates == 0 ? 0.0 : static_cast<f64>(prefiltered) / static_cast<f64>(candidates);
+        }
+
+        [[nodiscard]] f64 subsetsPerRejection() const {
+            return rejected == 0 ? 0.0 : static_cast<f64>(rejectedSubsets) / static_cast<f64>(rejected);
+        }
+    };
+} // namespace stoat::search
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2025 Ciekce
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "../types.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../core.h"
+#include "magic.h"
+#include "span.h"
+#include "square_table.h"
+
+namespace stoat::search {
+    // a page of attack table entries, assuming each square's table starts on a page
+    constexpr usize kEntriesPerPage = 4096 / sizeof(Bitboard);
+
+    // lookups recorded for each subset of each square's mask, indexed like
+    // SquareTable::occupancies. empty for squares with no recorded lookups
+    using TraceWeights = std::array<std::vector<u32>, Squares::kCount>;
+
+    enum class TraceObjective {
+        // fewest cache lines serving the traced lookups
+        kCacheLines,
+        // fewest pages serving the traced lookups
+        kPages,
+    };
+
+    // the index of an occupancy's masked subset in carry-rippler order
+    [[nodiscard]] inline usize subsetIndex(const SquareTable& table, Bitboard occ) {
+        usize idx = 0;
+
+        for (i32 i = 0; i < table.maskBits; ++i) {
+            if (occ.getSquare(Square::fromRaw(table.bitPositions[i]))) {
+                idx |= usize{1} << i;
+            }
+        }
+
+        return idx;
+    }
+
+    // reads a trace of sliding-attack lookups, one `<square> <high> <low>` line
+    // per lookup, where high and low are the halves of the occupied bitboard
+    // (e.g. "5e 0x1ff 0x3fe00000000"). lines for squares without a table are
+    // skipped. returns no weights if the file is missing or malformed
+    [[nodiscard]] inline TraceWeights loadOccupancyTrace(std::string_view path, std::span<const SquareTable> tables) {
+        std::ifstream stream{std::string{path}, std::ios::binary};
+
+        if (!stream) {
+            std::cerr << "failed to open occupancy trace " << path << std::endl;
+            return {};
+        }
+
+        TraceWeights weights{};
+
+        std::string line{};
+        usize lineNumber = 0;
+
+        while (std::getline(stream, line)) {
+            ++lineNumber;
+
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            std::istringstream fields{line};
+
+            std::string sqStr{};
+            std::string highStr{};
+            std::string lowStr{};
+
+            fields >> sqStr >> highStr >> lowStr;
+
+            const auto sq = Square::fromStr(sqStr);
+
+            if (!sq || lowStr.empty()) {
+                std::cerr << "malformed line " << lineNumber << " in occupancy trace " << path << std::endl;
+                return {};
+            }
+
+            const auto& table = tables[sq.idx()];
+
+            if (table.size() == 0) {
+                continue;
+            }
+
+            const u64 high = std::strtoull(highStr.c_str(), nullptr, 0);
+            const u64 low = std::strtoull(lowStr.c_str(), nullptr, 0);
+
+            auto& squareWeights = weights[sq.idx()];
+            squareWeights.resize(table.size());
+
+            ++squareWeights[subsetIndex(table, Bitboard{toU128(high, low)})];
+        }
+
+        return weights;
+    }
+
+    struct TracedSpan {
+        u64 lookups;
+        // the fewest cache lines and pages serving the requested share of lookups
+        usize cacheLines;
+        usize pages;
+    };
+
+    // how tightly a magic packs the traced lookups. the hottest lines and pages
+    // are counted until they serve `coverage` of the lookups, so rarely seen
+    // subsets do not weigh as much as the common ones
+    [[nodiscard]] inline TracedSpan tracedSpan(
+        const SquareTable& table,
+        std::span<const u32> weights,
+        u128 magic,
+        i32 shift,
+        f64 coverage
+    ) {
+        const auto entries = usize{1} << (128 - shift);
+
+        std::vector<u64> lineLookups(entries / kEntriesPerCacheLine + 1);
+        std::vector<u64> pageLookups(entries / kEntriesPerPage + 1);
+
+        TracedSpan span{};
+
+        for (usize occIdx = 0; occIdx < weights.size(); ++occIdx) {
+            if (weights[occIdx] == 0) {
+                continue;
+            }
+
+            const auto idx = getIdx(table.keyBits, table.occupancies[occIdx], magic, shift);
+
+            lineLookups[idx / kEntriesPerCacheLine] += weights[occIdx];
+            pageLookups[idx / kEntriesPerPage] += weights[occIdx];
+
+            span.lookups += weights[occIdx];
+        }
+
+        const auto target = static_cast<u64>(coverage * static_cast<f64>(span.lookups));
+
+        const auto hottest = [&](std::vector<u64>& lookups) {
+            std::ranges::sort(lookups, std::greater{});
+
+            usize count = 0;
+
+            for (u64 served = 0; served < target; served += lookups[count++]) {}
+
+            return count;
+        };
+
+        span.cacheLines = hottest(lineLookups);
+        span.pages = hottest(pageLookups);
+
+        return span;
+    }
+
+    [[nodiscard]] constexpr usize tracedCost(TraceObjective objective, const TracedSpan& span) {
+        return objective == TraceObjective::kCacheLines ? span.cacheLines : span.pages;
+    }
+} // namespace stoat::search
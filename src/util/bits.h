@@ -92,6 +92,11 @@ namespace stoat::util {
         return std::popcount(high) + std::popcount(low);
     }
 
+    [[nodiscard]] constexpr i32 bitWidth(u128 v) {
+        const auto [high, low] = fromU128(v);
+        return high != 0 ? 64 + static_cast<i32>(std::bit_width(high)) : static_cast<i32>(std::bit_width(low));
+    }
+
     [[nodiscard]] constexpr u128 pext(u128 v, u128 mask, i32 shift) {
 #if ST_HAS_FAST_PEXT
         if (std::is_constant_evaluated()) {